@@ -0,0 +1,168 @@
+#include "aliases.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define MAX_NAME_SIZE 256
+
+static struct HashTable* g_aliases = NULL;
+static int g_aliasesVersion = 0;
+
+void initAliases()
+{
+	g_aliases = createHashTable(free);
+}
+
+void freeAliases()
+{
+	freeHashTable(g_aliases);
+	g_aliases = NULL;
+}
+
+const char* findAlias(const char* name, int length)
+{
+	char key[MAX_NAME_SIZE];
+	if (!g_aliases || !g_aliases->size || length >= MAX_NAME_SIZE)
+		return NULL;
+
+	memcpy(key, name, (size_t)length);
+	key[length] = '\0';
+	return getHashTableValue(g_aliases, key);
+}
+
+int getAliasesVersion()
+{
+	return g_aliasesVersion;
+}
+
+/* value is quoted, so the output can be run again */
+static void printAlias(const char* name, const char* value)
+{
+	printf("alias %s='", name);
+	for (; *value; ++value)
+	{
+		if (*value == '\'')
+			printf("'\\''");
+		else
+			putchar(*value);
+	}
+
+	printf("'\n");
+}
+
+static int compareNames(const void* left, const void* right)
+{
+	return strcmp(*(char* const*)left, *(char* const*)right);
+}
+
+static void printAliases()
+{
+	struct StringArray* names = createStringArray();
+	for (int i = 0; i < g_aliases->capacity; ++i)
+	{
+		for (const struct HashEntry* entry = g_aliases->buckets[i]; entry; entry = entry->next)
+			addString(names, entry->key);
+	}
+
+	qsort(names->data, (size_t)names->size, sizeof(char*), compareNames);
+	for (int i = 0; i < names->size; ++i)
+		printAlias(names->data[i], getHashTableValue(g_aliases, names->data[i]));
+
+	freeStringArray(names);
+}
+
+/* alias names cannot contain symbols which end a word or quote it */
+static int isAliasName(const char* name, int length)
+{
+	if (!length || length >= MAX_NAME_SIZE)
+		return 0;
+
+	for (int i = 0; i < length; ++i)
+	{
+		if (strchr(" \t\n;&|<>()'\"\\$`*?[]{}#", name[i]))
+			return 0;
+	}
+
+	return 1;
+}
+
+int alias(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printAliases();
+		return 0;
+	}
+
+	int ret = 0;
+	char name[MAX_NAME_SIZE];
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* separator = strchr(argv[i], '=');
+		if (!separator)
+		{
+			const char* value = getHashTableValue(g_aliases, argv[i]);
+			if (value)
+			{
+				printAlias(argv[i], value);
+			}
+			else
+			{
+				fprintf(ERROR_OUTPUT, "alias: %s: not found\n", argv[i]);
+				ret = 1;
+			}
+
+			continue;
+		}
+
+		int length = (int)(separator - argv[i]);
+		if (!isAliasName(argv[i], length))
+		{
+			fprintf(ERROR_OUTPUT, "alias: `%.*s': invalid alias name\n", length, argv[i]);
+			ret = 1;
+			continue;
+		}
+
+		memcpy(name, argv[i], (size_t)length);
+		name[length] = '\0';
+		setHashTableValue(g_aliases, name, duplicateString(separator + 1));
+		g_aliasesVersion++;
+	}
+
+	return ret;
+}
+
+int unalias(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(ERROR_OUTPUT, "unalias: usage: unalias [-a] name [name ...]\n");
+		return 2;
+	}
+
+	if (!strcmp(argv[1], "-a"))
+	{
+		emptyHashTable(g_aliases);
+		g_aliasesVersion++;
+		return 0;
+	}
+
+	int ret = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!removeHashTableValue(g_aliases, argv[i]))
+		{
+			fprintf(ERROR_OUTPUT, "unalias: %s: not found\n", argv[i]);
+			ret = 1;
+			continue;
+		}
+
+		g_aliasesVersion++;
+	}
+
+	return ret;
+}
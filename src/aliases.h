@@ -0,0 +1,23 @@
+#ifndef ALIASES_H
+#define ALIASES_H
+
+/* Aliases are replaced by their text while a line is parsed,
+ * so every change makes parse trees built before it stale. */
+
+void initAliases();
+void freeAliases();
+
+/* Returns NULL if there is no alias with such name. */
+const char* findAlias(const char* name, int length);
+
+/* Changes every time an alias is added or removed. */
+int getAliasesVersion();
+
+/* alias [name[=value] ...]
+ * Without arguments prints all aliases. */
+int alias(int argc, char** argv);
+
+/* unalias [-a] name ... */
+int unalias(int argc, char** argv);
+
+#endif
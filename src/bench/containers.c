@@ -0,0 +1,156 @@
+/* Containers of utils.c: strings, arrays, arena and hash table.
+ * Usage: bench/containers [elements]
+ * Prints one line per operation, the median of several runs:
+ * containers: op=<name> n=<n> ns=<ns per element> */
+
+#include "../utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct _IO_FILE* ERROR_OUTPUT;
+
+#define N_RUNS 7
+
+static char** g_keys = NULL;
+static volatile long g_sink = 0; /* keeps results of lookups alive */
+
+static double getSeconds(const struct timespec* start, const struct timespec* end)
+{
+	return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int compareDoubles(const void* left, const void* right)
+{
+	double l = *(const double*)left;
+	double r = *(const double*)right;
+	return (l > r) - (l < r);
+}
+
+static void addSymbolOp(int n)
+{
+	struct String* s = createString();
+	for (int i = 0; i < n; ++i)
+		addSymbol(s, (char)('a' + i % 26));
+
+	g_sink += s->size;
+	freeString(s);
+}
+
+static void addSymbolsOp(int n)
+{
+	struct String* s = createString();
+	for (int i = 0; i < n; ++i)
+		addSymbols(s, "word ", 5);
+
+	g_sink += s->size;
+	freeString(s);
+}
+
+static void addIntOp(int n)
+{
+	struct IntArray* ia = createIntArray();
+	for (int i = 0; i < n; ++i)
+		addInt(ia, i);
+
+	g_sink += ia->size;
+	freeIntArray(ia);
+}
+
+static void addStringOp(int n)
+{
+	struct StringArray* sa = createStringArray();
+	for (int i = 0; i < n; ++i)
+		addString(sa, g_keys[i]);
+
+	g_sink += sa->size;
+	freeStringArray(sa);
+}
+
+static void allocateOp(int n)
+{
+	struct Arena* arena = createArena();
+	for (int i = 0; i < n; ++i)
+		g_sink += (long)(*(char*)allocateFromArena(arena, 24) = 1);
+
+	freeArena(arena);
+}
+
+/* set, get and remove are timed together, a table cannot be reused between runs */
+static void hashTableOp(int n)
+{
+	struct HashTable* ht = createHashTable(NULL);
+	for (int i = 0; i < n; ++i)
+		setHashTableValue(ht, g_keys[i], g_keys[i]);
+
+	for (int i = 0; i < n; ++i)
+		g_sink += getHashTableValue(ht, g_keys[(i * 7) % n]) != NULL;
+
+	for (int i = 0; i < n; ++i)
+		g_sink += removeHashTableValue(ht, g_keys[i]);
+
+	freeHashTable(ht);
+}
+
+static void hashStringOp(int n)
+{
+	for (int i = 0; i < n; ++i)
+		g_sink += hashString(g_keys[i]);
+}
+
+struct Operation
+{
+	const char* name;
+	void (*function)(int n);
+};
+
+static const struct Operation g_operations[] =
+{
+	{ "string_add_symbol", addSymbolOp },
+	{ "string_add_symbols", addSymbolsOp },
+	{ "int_array_add", addIntOp },
+	{ "string_array_add", addStringOp },
+	{ "arena_allocate", allocateOp },
+	{ "hash_string", hashStringOp },
+	{ "hash_table_set_get_remove", hashTableOp },
+};
+
+#define N_OPERATIONS (int)(sizeof(g_operations) / sizeof(g_operations[0]))
+
+int main(int argc, char** argv)
+{
+	ERROR_OUTPUT = stderr;
+
+	int n = argc > 1 ? atoi(argv[1]) : 1000000;
+	g_keys = malloc((size_t)n * sizeof(char*));
+	for (int i = 0; i < n; ++i)
+	{
+		char key[32];
+		snprintf(key, sizeof(key), "VARIABLE_%d", i);
+		g_keys[i] = duplicateString(key);
+	}
+
+	for (int i = 0; i < N_OPERATIONS; ++i)
+	{
+		double runs[N_RUNS];
+		for (int j = 0; j < N_RUNS; ++j)
+		{
+			struct timespec start, end;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			g_operations[i].function(n);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			runs[j] = getSeconds(&start, &end);
+		}
+
+		qsort(runs, N_RUNS, sizeof(double), compareDoubles);
+		printf("containers: op=%s n=%d ns=%.2f\n", g_operations[i].name, n, runs[N_RUNS / 2] * 1e9 / n);
+	}
+
+	for (int i = 0; i < n; ++i)
+		free(g_keys[i]);
+
+	free(g_keys);
+	return 0;
+}
@@ -0,0 +1,109 @@
+/* Search in a large history: trigram index against a linear scan.
+ * Usage: bench/history [entries] [queries]
+ * Prints: history: entries=<n> queries=<n> index_ms=<ms> indexed_us=<us> linear_us=<us> */
+
+#define _GNU_SOURCE
+
+#include "../history.h"
+#include "../utils.h"
+#include "../variables.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct _IO_FILE* ERROR_OUTPUT;
+
+static const char* g_templates[] =
+{
+	"git commit -m 'fix issue %d'",
+	"ssh host%d.example.com uptime",
+	"make -j8 target%d",
+	"grep -rn pattern%d src/ | sort | uniq -c",
+	"echo %d > /tmp/value",
+};
+
+#define N_TEMPLATES (int)(sizeof(g_templates) / sizeof(g_templates[0]))
+
+static double getSeconds(const struct timespec* start, const struct timespec* end)
+{
+	return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* what findHistoryEntry does without the index */
+static int findLinear(const struct History* history, const char* pattern, int size)
+{
+	for (int number = getLastHistoryNumber(history); number >= getFirstHistoryNumber(history); --number)
+	{
+		const struct StringView* entry = getHistoryEntry(history, number);
+		if (memmem(entry->data, (size_t)entry->size, pattern, (size_t)size))
+			return number;
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	ERROR_OUTPUT = stderr;
+
+	int nEntries = argc > 1 ? atoi(argv[1]) : 1000000;
+	int nQueries = argc > 2 ? atoi(argv[2]) : 200;
+
+	char value[16];
+	snprintf(value, sizeof(value), "%d", nEntries);
+	initVariables(NULL);
+	setVariable("HISTSIZE", value);
+
+	struct History* history = createHistory();
+	char line[128];
+	for (int i = 0; i < nEntries; ++i)
+	{
+		snprintf(line, sizeof(line), g_templates[i % N_TEMPLATES], i);
+		addHistoryEntry(history, line);
+	}
+
+	/* rare queries, every one matches a single old entry */
+	char** queries = malloc((size_t)nQueries * sizeof(char*));
+	srand(1);
+	for (int i = 0; i < nQueries; ++i)
+	{
+		snprintf(line, sizeof(line), "host%d.", (rand() % (nEntries / N_TEMPLATES)) * N_TEMPLATES + 1);
+		queries[i] = duplicateString(line);
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	findHistoryEntry(history, "xyz", 3, 0, 1);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double indexSeconds = getSeconds(&start, &end);
+
+	int nIndexed = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < nQueries; ++i)
+		nIndexed += findHistoryEntry(history, queries[i], (int)strlen(queries[i]), 0, getLastHistoryNumber(history) + 1) != 0;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double indexedSeconds = getSeconds(&start, &end);
+
+	int nLinear = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < nQueries; ++i)
+		nLinear += findLinear(history, queries[i], (int)strlen(queries[i])) != 0;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double linearSeconds = getSeconds(&start, &end);
+
+	if (nIndexed != nLinear)
+		fprintf(stderr, "history: indexed search found %d entries, linear %d\n", nIndexed, nLinear);
+
+	printf("history: entries=%d queries=%d index_ms=%.1f indexed_us=%.2f linear_us=%.2f\n",
+		nEntries, nQueries, indexSeconds * 1e3, indexedSeconds * 1e6 / nQueries, linearSeconds * 1e6 / nQueries);
+
+	for (int i = 0; i < nQueries; ++i)
+		free(queries[i]);
+
+	free(queries);
+	freeHistory(history);
+	freeVariables();
+	return nIndexed != nLinear;
+}
@@ -0,0 +1,164 @@
+/* Parsing and history expansion of generated command lines.
+ * Usage: bench/parser [kilobytes]
+ * Prints one line per corpus, the median of several runs:
+ * parser: corpus=<name> bytes=<n> jobs=<n> us=<us per line> mbps=<MiB/s>
+ * history_expand: corpus=<name> bytes=<n> us=<us per line> mbps=<MiB/s> */
+
+#include "../history.h"
+#include "../parser.h"
+#include "../utils.h"
+#include "../variables.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct _IO_FILE* ERROR_OUTPUT;
+
+#define N_RUNS 7
+#define MIN_RUN_SECONDS 0.05
+
+struct Corpus
+{
+	const char* name;
+	const char* first;  /* generated text starts with it */
+	const char* repeat; /* and repeats this until it has the size */
+	const char* last;
+};
+
+/* every corpus is one command line of about the requested size */
+static const struct Corpus g_parserCorpora[] =
+{
+	{ "long_line", "echo", " argument_with_some_length", "" },
+	{ "many_jobs", "", "echo value > /tmp/out; ", "true" },
+	{ "deep_pipeline", "cat /etc/hostname", " | cat", "" },
+	{ "quoting", "echo", " 'single quoted text' \"double $HOME ${PATH} quoted\" esc\\ aped\\\"", "" },
+	{ "variables", "echo", " $HOME${USER}x$1 \"$PATH:$#\"", "" },
+};
+
+static const struct Corpus g_historyCorpora[] =
+{
+	{ "plain", "echo", " no references at all", "" },
+	{ "references", "echo", " !! !-2 !ec !?host?", "" },
+	{ "quoted", "echo", " '!! !-2' \"text\"", "" },
+};
+
+#define N_PARSER_CORPORA (int)(sizeof(g_parserCorpora) / sizeof(g_parserCorpora[0]))
+#define N_HISTORY_CORPORA (int)(sizeof(g_historyCorpora) / sizeof(g_historyCorpora[0]))
+
+static double getSeconds(const struct timespec* start, const struct timespec* end)
+{
+	return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int compareDoubles(const void* left, const void* right)
+{
+	double l = *(const double*)left;
+	double r = *(const double*)right;
+	return (l > r) - (l < r);
+}
+
+static char* generateText(const struct Corpus* corpus, int bytes)
+{
+	struct String* s = createString();
+	addSymbols(s, corpus->first, (int)strlen(corpus->first));
+	while (s->size < bytes)
+		addSymbols(s, corpus->repeat, (int)strlen(corpus->repeat));
+
+	addSymbols(s, corpus->last, (int)strlen(corpus->last));
+
+	char* text = duplicateString(s->data);
+	freeString(s);
+	return text;
+}
+
+/* runs the function until MIN_RUN_SECONDS pass, N_RUNS times; returns median seconds per call */
+static double measure(void (*function)(const char*, void*), const char* text, void* context)
+{
+	double runs[N_RUNS];
+	for (int i = 0; i < N_RUNS; ++i)
+	{
+		struct timespec start, end;
+		long nCalls = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do
+		{
+			function(text, context);
+			++nCalls;
+			clock_gettime(CLOCK_MONOTONIC, &end);
+		}
+		while (getSeconds(&start, &end) < MIN_RUN_SECONDS);
+
+		runs[i] = getSeconds(&start, &end) / (double)nCalls;
+	}
+
+	qsort(runs, N_RUNS, sizeof(double), compareDoubles);
+	return runs[N_RUNS / 2];
+}
+
+static void parse(const char* text, void* arena)
+{
+	if (!parseProgramm(text, arena))
+	{
+		fprintf(stderr, "parser: syntax error in the corpus\n");
+		exit(1);
+	}
+
+	emptyArena(arena);
+}
+
+static void expand(const char* text, void* history)
+{
+	char* line = expandHistory(text, history);
+	if (!line)
+	{
+		fprintf(stderr, "history_expand: reference not found in the corpus\n");
+		exit(1);
+	}
+
+	free(line);
+}
+
+int main(int argc, char** argv)
+{
+	ERROR_OUTPUT = stderr;
+
+	int bytes = (argc > 1 ? atoi(argv[1]) : 64) * 1024;
+	initVariables(NULL);
+
+	struct Arena* arena = createArena();
+	for (int i = 0; i < N_PARSER_CORPORA; ++i)
+	{
+		char* text = generateText(&g_parserCorpora[i], bytes);
+		int size = (int)strlen(text);
+		int nJobs = parseProgramm(text, arena)->size;
+		emptyArena(arena);
+
+		double seconds = measure(parse, text, arena);
+		printf("parser: corpus=%s bytes=%d jobs=%d us=%.1f mbps=%.1f\n",
+			g_parserCorpora[i].name, size, nJobs, seconds * 1e6, size / seconds / (1 << 20));
+		free(text);
+	}
+
+	freeArena(arena);
+
+	struct History* history = createHistory();
+	addHistoryEntry(history, "ssh host1.example.com uptime");
+	addHistoryEntry(history, "echo previous");
+	addHistoryEntry(history, "ls -la");
+	for (int i = 0; i < N_HISTORY_CORPORA; ++i)
+	{
+		char* text = generateText(&g_historyCorpora[i], bytes);
+		int size = (int)strlen(text);
+
+		double seconds = measure(expand, text, history);
+		printf("history_expand: corpus=%s bytes=%d us=%.1f mbps=%.1f\n",
+			g_historyCorpora[i].name, size, seconds * 1e6, size / seconds / (1 << 20));
+		free(text);
+	}
+
+	freeHistory(history);
+	freeVariables();
+	return 0;
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Throughput of a multi-stage pipeline for different pipe capacities.
+# Usage: bench/pipesize.sh [shell binary] [megabytes]
+# Prints one line per capacity:
+# pipesize: bytes=<n> mbytes=<n> seconds=<s> mbps=<MiB/s>
+
+SHELL_BIN=${1:-./shell}
+MBYTES=${2:-1024}
+SIZES="4096 16384 65536 262144 1048576"
+
+for size in $SIZES; do
+	start=$(date +%s.%N)
+	printf 'set +o optimize\nset -o pipesize=%s\nhead -c %sM /dev/zero | cat | cat | cat > /dev/null\n' "$size" "$MBYTES" \
+		| "$SHELL_BIN" > /dev/null
+	end=$(date +%s.%N)
+
+	echo "$size $MBYTES $start $end" | awk '{ s = $4 - $3; printf "pipesize: bytes=%d mbytes=%d seconds=%.3f mbps=%.1f\n", $1, $2, s, $2 / s }'
+done
@@ -0,0 +1,88 @@
+/* Throughput of getLine on a generated multi-megabyte script.
+ * Usage: bench/reader [megabytes]
+ * Prints: reader: mbytes=<n> lines=<n> seconds=<s> mbps=<MiB/s> */
+
+#include "../utils.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct _IO_FILE* ERROR_OUTPUT;
+
+static const char* g_lines[] =
+{
+	"echo hello world\n",
+	"ls -la /tmp | grep log | wc -l > /tmp/count.txt\n",
+	"cat 'file with spaces' \"and $HOME\" | sort | uniq -c\n",
+	"echo continued \\\n line\n",
+	"# just a comment which is a bit longer than the other lines in this script\n",
+};
+
+#define N_LINES (int)(sizeof(g_lines) / sizeof(g_lines[0]))
+
+static int generateScript(long bytes)
+{
+	char path[] = "/tmp/shell_bench_reader_XXXXXX";
+	int fd = mkstemp(path);
+	if (fd == -1)
+		return -1;
+
+	unlink(path);
+
+	long written = 0;
+	for (int i = 0; written < bytes; ++i)
+	{
+		const char* line = g_lines[i % N_LINES];
+		size_t length = strlen(line);
+		if (write(fd, line, length) != (ssize_t)length)
+			break;
+
+		written += (long)length;
+	}
+
+	lseek(fd, 0, SEEK_SET);
+	return fd;
+}
+
+int main(int argc, char** argv)
+{
+	ERROR_OUTPUT = stderr;
+
+	int mbytes = argc > 1 ? atoi(argv[1]) : 64;
+	int fd = generateScript((long)mbytes << 20);
+	if (fd == -1)
+	{
+		perror("reader");
+		return 1;
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	struct LineReader* reader = createLineReader(fd);
+	char* buffer = NULL;
+	int size = 0;
+	long nLines = 0;
+	while (1)
+	{
+		int index = 0;
+		if (getLine(reader, &buffer, &size, &index) || index == 0)
+			break;
+
+		++nLines;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	free(buffer);
+	freeLineReader(reader);
+	close(fd);
+
+	double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("reader: mbytes=%d lines=%ld seconds=%.3f mbps=%.1f\n", mbytes, nLines, seconds, mbytes / seconds);
+	return 0;
+}
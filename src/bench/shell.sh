@@ -0,0 +1,43 @@
+#!/bin/sh
+# End-to-end runs of the shell binary: latency of a command in a script
+# and throughput of pipelines with a growing number of stages.
+# Usage: bench/shell.sh [shell binary] [commands] [megabytes]
+# Prints:
+# shell: test=commands n=<n> seconds=<s> us=<us per command>
+# shell: test=pipeline stages=<n> mbytes=<n> seconds=<s> mbps=<MiB/s>
+
+SHELL_BIN=${1:-./shell}
+COMMANDS=${2:-2000}
+MBYTES=${3:-512}
+STAGES="1 2 4 8 16"
+
+SCRIPT=$(mktemp /tmp/shell_bench_XXXXXX)
+trap 'rm -f "$SCRIPT"' EXIT
+
+# every line starts a program, so the time is spent in parse, spawn and wait
+i=0
+: > "$SCRIPT"
+while [ $i -lt "$COMMANDS" ]; do
+	echo "/bin/true $i" >> "$SCRIPT"
+	i=$((i + 1))
+done
+
+start=$(date +%s.%N)
+"$SHELL_BIN" "$SCRIPT" > /dev/null
+end=$(date +%s.%N)
+echo "$COMMANDS $start $end" | awk '{ s = $3 - $2; printf "shell: test=commands n=%d seconds=%.3f us=%.1f\n", $1, s, s * 1e6 / $1 }'
+
+for stages in $STAGES; do
+	pipeline="head -c ${MBYTES}M /dev/zero"
+	i=0
+	while [ $i -lt "$stages" ]; do
+		pipeline="$pipeline | cat"
+		i=$((i + 1))
+	done
+
+	start=$(date +%s.%N)
+	printf 'set +o optimize\n%s > /dev/null\n' "$pipeline" | "$SHELL_BIN" > /dev/null
+	end=$(date +%s.%N)
+
+	echo "$stages $MBYTES $start $end" | awk '{ s = $4 - $3; printf "shell: test=pipeline stages=%d mbytes=%d seconds=%.3f mbps=%.1f\n", $1, $2, s, $2 / s }'
+done
@@ -0,0 +1,112 @@
+/* Latency of starting a command and waiting for it: posix_spawn used for
+ * programs against fork + exec used for builtins in pipelines.
+ * Usage: bench/spawn [processes] [megabytes of padding]
+ * Padding makes the process larger, fork has to copy its page tables.
+ * Prints one line per method, the median of several batches:
+ * spawn: method=<name> n=<n> rss_mb=<n> us=<us per process> */
+
+#define _GNU_SOURCE
+
+#include "../launcher.h"
+#include "../utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+struct _IO_FILE* ERROR_OUTPUT;
+
+#define N_RUNS 7
+#define PROGRAM "/bin/true"
+
+static char* const g_argv[] = { PROGRAM, NULL };
+extern char** environ;
+
+static double getSeconds(const struct timespec* start, const struct timespec* end)
+{
+	return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int compareDoubles(const void* left, const void* right)
+{
+	double l = *(const double*)left;
+	double r = *(const double*)right;
+	return (l > r) - (l < r);
+}
+
+static pid_t startWithSpawn()
+{
+	int error = 0;
+	return spawnProcess(PROGRAM, g_argv, environ, STDIN_FILENO, STDOUT_FILENO, PGID_NONE, &error);
+}
+
+static pid_t startWithFork()
+{
+	pid_t cpid = forkProcess(STDIN_FILENO, STDOUT_FILENO, PGID_NONE);
+	if (!cpid)
+	{
+		execve(PROGRAM, g_argv, environ);
+		_exit(127);
+	}
+
+	return cpid;
+}
+
+struct Method
+{
+	const char* name;
+	pid_t (*start)();
+};
+
+static const struct Method g_methods[] =
+{
+	{ "posix_spawn", startWithSpawn },
+	{ "fork_exec", startWithFork },
+};
+
+#define N_METHODS (int)(sizeof(g_methods) / sizeof(g_methods[0]))
+
+int main(int argc, char** argv)
+{
+	ERROR_OUTPUT = stderr;
+
+	int n = argc > 1 ? atoi(argv[1]) : 200;
+	int paddingMb = argc > 2 ? atoi(argv[2]) : 64;
+
+	/* touched, so the pages are really mapped */
+	char* padding = malloc((size_t)paddingMb << 20);
+	if (paddingMb > 0)
+		memset(padding, 1, (size_t)paddingMb << 20);
+
+	for (int i = 0; i < N_METHODS; ++i)
+	{
+		double runs[N_RUNS];
+		for (int j = 0; j < N_RUNS; ++j)
+		{
+			struct timespec start, end;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (int k = 0; k < n; ++k)
+			{
+				int wstatus;
+				pid_t cpid = g_methods[i].start();
+				if (cpid == -1 || waitpid(cpid, &wstatus, 0) == -1 || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus))
+				{
+					fprintf(stderr, "spawn: %s: cannot run %s\n", g_methods[i].name, PROGRAM);
+					return 1;
+				}
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			runs[j] = getSeconds(&start, &end);
+		}
+
+		qsort(runs, N_RUNS, sizeof(double), compareDoubles);
+		printf("spawn: method=%s n=%d rss_mb=%d us=%.1f\n", g_methods[i].name, n, paddingMb, runs[N_RUNS / 2] * 1e6 / n);
+	}
+
+	free(padding);
+	return 0;
+}
@@ -1,4 +1,13 @@
+#include "aliases.h"
 #include "commands.h"
+#include "functions.h"
+#include "jobtable.h"
+#include "parallel.h"
+#include "parsecache.h"
+#include "pathcache.h"
+#include "prompt.h"
+#include "trace.h"
+#include "variables.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -9,22 +18,85 @@
 #include <linux/limits.h>
 
 extern struct _IO_FILE* ERROR_OUTPUT;
+extern struct History* g_history;
+extern int g_exitShell;
+extern int g_lastStatus;
+
+struct ShellOptions g_shellOptions = { .optimize = 1 };
+
+struct ShellOption
+{
+	const char* name;
+	int* value;
+	int numeric; /* set with "set -o name=value" */
+};
+
+static const struct ShellOption g_optionsList[] =
+{
+	{ "optimize", &g_shellOptions.optimize, 0 },
+	{ "pipefail", &g_shellOptions.pipefail, 0 },
+	{ "pipesize", &g_shellOptions.pipeSize, 1 },
+	{ "showplan", &g_shellOptions.showplan, 0 },
+	{ "timejobs", &g_shellOptions.timejobs, 0 },
+	{ "trace", &g_tracing, 0 },
+};
+
+#define N_OPTIONS (int)(sizeof(g_optionsList) / sizeof(g_optionsList[0]))
+
+/* sorted by name */
+static const struct Builtin g_builtins[] =
+{
+	{ "alias", alias },
+	{ "bg", bg },
+	{ "cd", cd },
+	{ "exit", exitShell },
+	{ "export", export },
+	{ "fg", fg },
+	{ "hash", hash },
+	{ "history", history },
+	{ "jobs", jobs },
+	{ "parallel", parallel },
+	{ "parsecache", parsecache },
+	{ "pwd", pwd },
+	{ "set", set },
+	{ "trace", trace },
+	{ "unalias", unalias },
+	{ "unset", unset },
+	{ "wait", waitJobs },
+};
+
+#define N_BUILTINS (int)(sizeof(g_builtins) / sizeof(g_builtins[0]))
+
+static int compareBuiltins(const void* key, const void* builtin)
+{
+	return strcmp(key, ((const struct Builtin*)builtin)->name);
+}
+
+const struct Builtin* findBuiltin(const char* name)
+{
+	return bsearch(name, g_builtins, N_BUILTINS, sizeof(struct Builtin), compareBuiltins);
+}
 
 int cd(int argc, char** argv)
 {
-	if (argc < 2)
+	const char* dir = argc < 2 ? getVariable("HOME") : argv[1];
+	if (!dir)
 	{
 		fprintf(ERROR_OUTPUT, "Too few arguments for command call.\n");
-		exit(1);
+		return 1;
 	}
 
-	int ret = chdir(argv[1]);
+	int ret = chdir(dir);
 	if (ret == -1)
 	{
 		char* error = strerror(errno);
 		if(error)
 			fprintf(ERROR_OUTPUT, "%s\n", error);
 	}
+	else
+	{
+		invalidatePromptDirectory();
+	}
 
 	return ret != 0;
 }
@@ -44,16 +116,189 @@ int pwd(int argc, char** argv)
 			fprintf(ERROR_OUTPUT, "%s\n", error);
 	}
 
-	return path != NULL;
+	return path == NULL;
 }
 
-int printHistory(const struct StringArray* history)
+int printHistory(const struct History* history)
 {
 	if (!history)
 		return 1;
 
-	for (int i = 0; i < history->size; ++i)
-		printf("#%d: %s\n", i + 1, history->data[i]);
+	for (int i = getFirstHistoryNumber(history); i <= getLastHistoryNumber(history); ++i)
+	{
+		const struct StringView* entry = getHistoryEntry(history, i);
+		printf("#%d: %.*s\n", i, entry->size, entry->data);
+	}
 
 	return 0;
-}
\ No newline at end of file
+}
+
+/* prints entries containing (or starting with) the pattern, oldest first */
+static int printFoundHistory(struct History* history, const char* pattern, int prefix)
+{
+	struct IntArray* found = createIntArray();
+	int size = (int)strlen(pattern);
+	int number = getLastHistoryNumber(history) + 1;
+	while ((number = findHistoryEntry(history, pattern, size, prefix, number)))
+		addInt(found, number);
+
+	for (int i = found->size - 1; i >= 0; --i)
+	{
+		const struct StringView* entry = getHistoryEntry(history, found->data[i]);
+		printf("#%d: %.*s\n", found->data[i], entry->size, entry->data);
+	}
+
+	int ret = found->size ? 0 : 1;
+	freeIntArray(found);
+	return ret;
+}
+
+int history(int argc, char** argv)
+{
+	if (argc < 2)
+		return printHistory(g_history);
+
+	int prefix = !strcmp(argv[1], "-p");
+	if (argc != 3 || (!prefix && strcmp(argv[1], "-s")))
+	{
+		fprintf(ERROR_OUTPUT, "history: usage: history [-s text | -p prefix]\n");
+		return 2;
+	}
+
+	return printFoundHistory(g_history, argv[2], prefix);
+}
+
+int exitShell(int argc, char** argv)
+{
+	g_exitShell = 1;
+	return argc > 1 ? atoi(argv[1]) & 0xff : g_lastStatus;
+}
+
+int hash(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printCommandHash();
+		return 0;
+	}
+
+	int ret = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-r"))
+		{
+			clearCommandHash();
+		}
+		else if (!hashCommand(argv[i]))
+		{
+			fprintf(ERROR_OUTPUT, "hash: %s: not found\n", argv[i]);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+int set(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		for (int i = 0; i < N_OPTIONS; ++i)
+		{
+			const struct ShellOption* option = &g_optionsList[i];
+			if (option->numeric)
+			{
+				if (*option->value)
+					printf("%-15s\t%d\n", option->name, *option->value);
+				else
+					printf("%-15s\t%s\n", option->name, "default");
+			}
+			else
+			{
+				printf("%-15s\t%s\n", option->name, *option->value ? "on" : "off");
+			}
+		}
+
+		return 0;
+	}
+
+	int enable;
+	if (!strcmp(argv[1], "-o"))
+	{
+		enable = 1;
+	}
+	else if (!strcmp(argv[1], "+o"))
+	{
+		enable = 0;
+	}
+	else
+	{
+		fprintf(ERROR_OUTPUT, "set: %s: invalid option\n", argv[1]);
+		return 1;
+	}
+
+	int ret = 0;
+	for (int i = 2; i < argc; ++i)
+	{
+		const char* value = strchr(argv[i], '=');
+		size_t nameLength = value ? (size_t)(value - argv[i]) : strlen(argv[i]);
+
+		int found = 0;
+		for (int j = 0; j < N_OPTIONS; ++j)
+		{
+			const struct ShellOption* option = &g_optionsList[j];
+			if (strlen(option->name) != nameLength || strncmp(argv[i], option->name, nameLength))
+				continue;
+
+			found = 1;
+			if (!option->numeric)
+			{
+				*option->value = enable;
+			}
+			else if (enable && (!value || atoi(value + 1) <= 0))
+			{
+				fprintf(ERROR_OUTPUT, "set: %s: positive value expected, use \"set -o %s=value\"\n", option->name, option->name);
+				ret = 1;
+			}
+			else
+			{
+				*option->value = enable ? atoi(value + 1) : 0;
+			}
+
+			break;
+		}
+
+		if (!found)
+		{
+			fprintf(ERROR_OUTPUT, "set: %s: invalid option name\n", argv[i]);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+int unset(int argc, char** argv)
+{
+	int functions = argc > 1 && !strcmp(argv[1], "-f");
+	int ret = 0;
+	for (int i = functions ? 2 : 1; i < argc; ++i)
+	{
+		if (functions)
+		{
+			unsetFunction(argv[i]);
+		}
+		else if (!isVariableName(argv[i]))
+		{
+			fprintf(ERROR_OUTPUT, "unset: `%s': not a valid identifier\n", argv[i]);
+			ret = 1;
+		}
+		else if (!unsetVariable(argv[i]))
+		{
+			/* as in bash, a function is removed if there is no such variable */
+			unsetFunction(argv[i]);
+		}
+	}
+
+	return ret;
+}
@@ -1,10 +1,41 @@
 #ifndef COMMANDS_H
 #define COMMANDS_H
 
+#include "history.h"
 #include "utils.h"
 
+/* options changed with "set -o name" / "set +o name" */
+struct ShellOptions
+{
+	int pipefail;
+	int optimize;
+	int showplan;
+	int timejobs; /* report resources of every job as "time" does */
+	int pipeSize; /* capacity of pipes between stages, 0 means system default */
+};
+
+extern struct ShellOptions g_shellOptions;
+
+typedef int (*BuiltinFunction)(int argc, char** argv);
+
+struct Builtin
+{
+	const char* name;
+	BuiltinFunction function;
+};
+
+/* Returns NULL if there is no builtin with such name. */
+const struct Builtin* findBuiltin(const char* name);
+
 int cd(int argc, char** argv);
 int pwd(int argc, char** argv);
-int printHistory(const struct StringArray* history);
+int printHistory(const struct History* history);
+int history(int argc, char** argv);
+int hash(int argc, char** argv);
+int set(int argc, char** argv);
+/* unset [-f] name ...
+ * Removes variables, or functions with -f. */
+int unset(int argc, char** argv);
+int exitShell(int argc, char** argv);
 
 #endif
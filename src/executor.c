@@ -0,0 +1,637 @@
+#define _GNU_SOURCE
+
+#include "commands.h"
+#include "executor.h"
+#include "expand.h"
+#include "functions.h"
+#include "jobtable.h"
+#include "launcher.h"
+#include "parsecache.h"
+#include "pathcache.h"
+#include "process.h"
+#include "trace.h"
+#include "utils.h"
+#include "variables.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/time.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+extern struct IntArray* g_pipeStatus;
+extern int g_lastStatus;
+extern pid_t g_lastBackgroundPid;
+extern int g_exitShell;
+
+struct Pipeline* volatile g_foregroundPipeline = NULL;
+
+static int isSubstitution(struct StringView word)
+{
+	return word.data && word.size > 1 && word.data[0] == SUBSTITUTION_MARK;
+}
+
+/* arguments point into words, which is filled here. "<(list)" and ">(list)" words
+ * become paths of descriptors from substitutions, which are in the order of the words. */
+static char** createArgsForExec(const struct Command* command, struct String* words, const struct IntArray* substitutions, int* nArgs)
+{
+	struct IntArray* offsets = createIntArray();
+	expandArgument(command->name, words, offsets);
+	for (int i = 0, j = 0; i < command->nArgs; ++i)
+	{
+		if (isSubstitution(command->args[i]))
+		{
+			char path[32];
+			addInt(offsets, words->size);
+			addSymbols(words, path, snprintf(path, sizeof(path), "/dev/fd/%d", substitutions->data[j++]) + 1);
+		}
+		else
+		{
+			expandArgument(command->args[i], words, offsets);
+		}
+	}
+
+	/* words may move while they are added, so pointers are taken at the end */
+	char** res = malloc((size_t)(offsets->size + 1) * sizeof(char*));
+	for (int i = 0; i < offsets->size; ++i)
+		res[i] = words->data + offsets->data[i];
+
+	res[offsets->size] = NULL;
+	*nArgs = offsets->size;
+	freeIntArray(offsets);
+	return res;
+}
+
+/* returns NULL if the command has no assignments */
+static char** createAssignmentsForExec(const struct Command* command)
+{
+	if (!command->nAssignments)
+		return NULL;
+
+	char** res = malloc((size_t)(command->nAssignments + 1) * sizeof(char*));
+	for (int i = 0; i < command->nAssignments; ++i)
+		res[i] = expandWord(command->assignments[i]);
+
+	res[command->nAssignments] = NULL;
+	return res;
+}
+
+static void freeWords(char** words)
+{
+	if (!words)
+		return;
+
+	for (char** curr = words; *curr; ++curr)
+		free(*curr);
+
+	free(words);
+}
+
+/* input is the expanded text, or NULL if the here-document has nothing to expand */
+static int openHereInput(const struct Command* command, char* input)
+{
+	if (!input)
+		return createInputDescriptor(command->input.data, command->input.size);
+
+	if (command->inputType == INPUT_HERE_DOCUMENT)
+		return createInputDescriptor(input, (int)strlen(input));
+
+	/* here-string ends with a new line, it takes place of the terminating zero for a moment */
+	int size = (int)strlen(input);
+	input[size] = '\n';
+	int fd = createInputDescriptor(input, size + 1);
+	input[size] = '\0';
+	return fd;
+}
+
+/* forked shell runs jobs of a function, they belong to the process group of the child */
+static void initSubshell()
+{
+	g_jobControl = 0;
+
+	/* processes of the parent are not waited for here */
+	freeProcessTable();
+	initProcessTable();
+}
+
+static void addUsage(struct rusage* total, const struct rusage* usage)
+{
+	timeradd(&total->ru_utime, &usage->ru_utime, &total->ru_utime);
+	timeradd(&total->ru_stime, &usage->ru_stime, &total->ru_stime);
+	total->ru_nvcsw += usage->ru_nvcsw;
+	total->ru_nivcsw += usage->ru_nivcsw;
+	total->ru_maxrss = max(total->ru_maxrss, usage->ru_maxrss);
+}
+
+/* maximum RSS is not a sum, so it stays as is */
+static void subtractUsage(struct rusage* usage, const struct rusage* before)
+{
+	timersub(&usage->ru_utime, &before->ru_utime, &usage->ru_utime);
+	timersub(&usage->ru_stime, &before->ru_stime, &usage->ru_stime);
+	usage->ru_nvcsw -= before->ru_nvcsw;
+	usage->ru_nivcsw -= before->ru_nivcsw;
+}
+
+/* stage run inside the shell also accounts for commands a function has waited for */
+static void getShellUsage(struct rusage* usage)
+{
+	struct rusage children;
+	getrusage(RUSAGE_SELF, usage);
+	getrusage(RUSAGE_CHILDREN, &children);
+	addUsage(usage, &children);
+}
+
+static double getElapsedSeconds(const struct timespec* start, const struct timespec* end)
+{
+	return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double getSeconds(const struct timeval* tv)
+{
+	return (double)tv->tv_sec + (double)tv->tv_usec / 1e6;
+}
+
+static void addUsageLine(struct String* s, const char* prefix, double real, const struct rusage* usage, const char* text)
+{
+	char line[256];
+	int size = snprintf(line, sizeof(line), "%sreal %.3fs  user %.3fs  sys %.3fs  maxrss %ldKB  csw %ld/%ld  ",
+		prefix, real, getSeconds(&usage->ru_utime), getSeconds(&usage->ru_stime), usage->ru_maxrss, usage->ru_nvcsw, usage->ru_nivcsw);
+
+	addSymbols(s, line, min(size, (int)sizeof(line) - 1));
+	addSymbols(s, text, (int)strlen(text));
+	addSymbol(s, '\n');
+}
+
+/* Runs the list of "<(list)" or ">(list)" in a forked shell connected to the command with a pipe.
+ * Returns the end of the pipe for the command or -1. The child keeps only its end of the pipe,
+ * so lists do not hold pipes of other substitutions and stages open. */
+static int startSubstitution(struct StringView word, struct Pipeline* pipeline, int index, pid_t* pgid)
+{
+	struct StringView list = { word.data + 2, word.size - 2 };
+	char* text = viewToString(list);
+	struct ParsedLine* line = acquireParsedLine(text);
+	free(text);
+	if (!line)
+		return -1;
+
+	int pfd[2];
+	if (createPipe(pfd, 0) == -1)
+	{
+		fprintf(ERROR_OUTPUT, "Cannot create pipe: %s\n", strerror(errno));
+		releaseParsedLine(line);
+		return -1;
+	}
+
+	/* the list writes into the pipe for "<(list)" and reads from it for ">(list)" */
+	int reading = word.data[1] == '<';
+	TRACE(TRACE_BEGIN, "substitution", 0, "index", index);
+	pid_t cpid = forkProcess(reading ? STDIN_FILENO : pfd[0], reading ? pfd[1] : STDOUT_FILENO, *pgid);
+	if (!cpid)
+	{
+		closeShellDescriptors(NULL, 0);
+		initSubshell();
+		runJobs(line->jobs);
+
+		/* exit() would also sync shell input stream and move its shared offset */
+		fflush(stdout);
+		_exit(g_lastStatus);
+	}
+
+	TRACE(TRACE_END, "substitution", cpid, NULL, 0);
+	releaseParsedLine(line);
+	close(reading ? pfd[1] : pfd[0]);
+	int fd = reading ? pfd[0] : pfd[1];
+	if (cpid == -1)
+	{
+		fprintf(ERROR_OUTPUT, "Cannot start process substitution: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	addPipelineProcess(pipeline->substitutions, index, cpid);
+	if (*pgid == PGID_NEW)
+		pipeline->pgid = *pgid = cpid;
+
+	return fd;
+}
+
+/* Starts substitutions of arguments, input and output of the command in this order and adds
+ * their descriptors to fds. Descriptors of arguments stay open in started programs.
+ * Returns 0 if one of them has failed. */
+static int startSubstitutions(const struct Command* command, struct Pipeline* pipeline, int* index, pid_t* pgid, struct IntArray* fds)
+{
+	int ok = 1;
+	for (int i = 0; i < command->nArgs; ++i)
+	{
+		if (!isSubstitution(command->args[i]))
+			continue;
+
+		int fd = startSubstitution(command->args[i], pipeline, (*index)++, pgid);
+		if (fd != -1)
+			fcntl(fd, F_SETFD, 0);
+
+		addInt(fds, fd);
+		ok &= fd != -1;
+	}
+
+	struct StringView redirections[2] = { command->input, command->output };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (!isSubstitution(redirections[i]))
+			continue;
+
+		int fd = startSubstitution(redirections[i], pipeline, (*index)++, pgid);
+		addInt(fds, fd);
+		ok &= fd != -1;
+	}
+
+	return ok;
+}
+
+static int countSubstitutions(const struct Job* job)
+{
+	int count = 0;
+	for (int i = 0; i < job->size; ++i)
+	{
+		const struct Command* command = job->commands[i];
+		for (int j = 0; j < command->nArgs; ++j)
+			count += isSubstitution(command->args[j]);
+
+		count += isSubstitution(command->input) + isSubstitution(command->output);
+	}
+
+	return count;
+}
+
+/* Job total and a line for every stage: voluntary/involuntary context switches, maximum RSS of
+ * the largest stage. Written to $TIMELOG if it is set, to stderr otherwise. */
+static void reportJobUsage(const struct Job* job, const struct Pipeline* pipeline)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	struct rusage total;
+	memset(&total, 0, sizeof(total));
+	for (int i = 0; i < pipeline->size; ++i)
+		addUsage(&total, &pipeline->usages[i].rusage);
+
+	struct String* s = createString();
+	char* text = jobToString(job);
+	addUsageLine(s, "", getElapsedSeconds(&pipeline->start, &end), &total, text);
+	free(text);
+
+	for (int i = 0; pipeline->size > 1 && i < pipeline->size; ++i)
+	{
+		char prefix[32];
+		snprintf(prefix, sizeof(prefix), "  [%d] ", i + 1);
+		text = commandToString(job->commands[i]);
+		addUsageLine(s, prefix, getElapsedSeconds(&pipeline->start, &pipeline->usages[i].end), &pipeline->usages[i].rusage, text);
+		free(text);
+	}
+
+	const char* path = getVariable("TIMELOG");
+	int fd = path ? open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666) : STDERR_FILENO;
+	if (fd == -1)
+		fprintf(ERROR_OUTPUT, "Cannot open time log: \"%s\": %s\n", path, strerror(errno));
+	else if (writeAll(fd, s->data, s->size) == -1)
+		fprintf(ERROR_OUTPUT, "Cannot write time log: %s\n", strerror(errno));
+
+	if (fd != -1 && fd != STDERR_FILENO)
+		close(fd);
+
+	freeString(s);
+}
+
+void saveJobStatus(const struct Pipeline* pipeline)
+{
+	emptyIntArray(g_pipeStatus);
+	for (int i = 0; i < pipeline->size; ++i)
+		addInt(g_pipeStatus, pipeline->statuses[i]);
+
+	g_lastStatus = getPipelineStatus(pipeline, g_shellOptions.pipefail);
+}
+
+struct Pipeline* startJob(const struct Job* job, int jobInfd, int jobOutfd, int async)
+{
+	struct Command** commands = job->commands;
+	int nCommands = job->size;
+
+	/* $PIPESIZE overrides "set -o pipesize=N" for separate pipelines */
+	const char* pipeSizeVar = getVariable("PIPESIZE");
+	int pipeSize = pipeSizeVar ? atoi(pipeSizeVar) : g_shellOptions.pipeSize;
+
+	struct Pipeline* pipeline = createPipeline(nCommands);
+	/* "set -o timejobs" applies to jobs started after it, so the job setting it is not reported */
+	int timed = pipeline->timed = job->timed || g_shellOptions.timejobs;
+	pid_t pgid = g_jobControl ? PGID_NEW : PGID_NONE;
+
+	int nSubstitutions = countSubstitutions(job);
+	if (nSubstitutions > 0)
+		pipeline->substitutions = createPipeline(nSubstitutions);
+
+	int substitution = 0; /* index of the next one in the pipeline */
+	int fd[2], pfd[2], prevfd = -1;
+	for (int i = 0; !g_exitShell && (i < nCommands); ++i)
+	{
+		const struct Command* command = commands[i];
+
+		/* descriptors of "<(list)" and ">(list)" words, closed after the command has started */
+		struct IntArray* substitutions = createIntArray();
+		int ok = startSubstitutions(command, pipeline, &substitution, &pgid, substitutions);
+		int substitutedInput = isSubstitution(command->input);
+		int substitutedOutput = isSubstitution(command->output);
+
+		struct String* words = createString();
+		int nArgs = 0;
+		char** args = createArgsForExec(command, words, substitutions, &nArgs);
+		char** assignments = createAssignmentsForExec(command);
+		/* here-document without parameters is passed as it is in the tree */
+		int literalInput = command->inputType == INPUT_HERE_DOCUMENT && !memchr(command->input.data, EXPANSION_MARK, (size_t)command->input.size);
+		char* input = literalInput || substitutedInput ? NULL : expandWord(command->input);
+		char* output = substitutedOutput ? NULL : expandWord(command->output);
+
+		if (i != nCommands - 1)
+			createPipe(pfd, pipeSize);
+		else
+			pfd[0] = pfd[1] = -1;
+
+		fd[0] = i == 0 ? jobInfd : prevfd;
+		fd[1] = i == nCommands - 1 ? jobOutfd : pfd[1];
+
+		int infd = -1, outfd = -1;
+		if (substitutedInput)
+		{
+			fd[0] = substitutions->data[substitutions->size - substitutedOutput - 1];
+		}
+		else if (command->input.data && command->inputType != INPUT_FILE)
+		{
+			TRACE(TRACE_BEGIN, "open", 0, "stage", i);
+			infd = fd[0] = openHereInput(command, input);
+			TRACE(TRACE_END, "open", 0, "fd", fd[0]);
+			if (fd[0] == -1)
+			{
+				fprintf(ERROR_OUTPUT, "Cannot create input of a here-document: %s\n", strerror(errno));
+				ok = 0;
+			}
+		}
+		else if (input)
+		{
+			TRACE(TRACE_BEGIN, "open", 0, "stage", i);
+			infd = fd[0] = open(input, O_RDONLY | O_CLOEXEC, 0666);
+			TRACE(TRACE_END, "open", 0, "fd", fd[0]);
+			if (fd[0] == -1)
+			{
+				fprintf(ERROR_OUTPUT, "Cannot open specified input file: \"%s\"\n", input);
+				ok = 0;
+			}
+		}
+
+		if (ok && substitutedOutput)
+		{
+			if(pfd[0] != -1)
+				close(pfd[0]);
+			pfd[0] = -1;
+
+			fd[1] = substitutions->data[substitutions->size - 1];
+		}
+		else if (ok && output)
+		{
+			if(pfd[0] != -1)
+				close(pfd[0]);
+			pfd[0] = -1;
+
+			int flags = command->rewriteOutput ? O_CREAT | O_WRONLY | O_TRUNC : O_CREAT | O_WRONLY | O_APPEND;
+			TRACE(TRACE_BEGIN, "open", 0, "stage", i);
+			outfd = fd[1] = open(output, flags | O_CLOEXEC, 0666);
+			TRACE(TRACE_END, "open", 0, "fd", fd[1]);
+			if (fd[1] == -1)
+			{
+				fprintf(ERROR_OUTPUT, "Cannot open specified output file: \"%s\"\n", output);
+				ok = 0;
+			}
+		}
+
+		if (ok)
+		{
+			int ret = 0;
+			const char* name = args[0];
+			struct Function* function = name && !command->body.data ? findFunction(name) : NULL;
+			const struct Builtin* builtin = name && !function ? findBuiltin(name) : NULL;
+			if (command->body.data)
+			{
+				ret = defineFunction(name, command->body);
+			}
+			else if (!name)
+			{
+				/* assignments alone set shell variables, unless they run in a pipeline or background */
+				for (int j = 0; !async && nCommands == 1 && j < command->nAssignments; ++j)
+					assignVariable(assignments[j]);
+			}
+			else if ((function || builtin) && !async && i == nCommands - 1)
+			{
+				/* builtin is not followed by other stages, so run it without fork */
+				struct rusage before, usage;
+				if (timed)
+					getShellUsage(&before);
+
+				TRACE(TRACE_BEGIN, function ? "function" : "builtin", 0, "stage", i);
+				int saved[2];
+				redirectStdio(fd[0], fd[1], saved);
+				ret = function ? callFunction(function, nArgs, args) : builtin->function(nArgs, args);
+				restoreStdio(saved);
+				TRACE(TRACE_END, function ? "function" : "builtin", 0, "status", ret);
+
+				if (timed)
+				{
+					getShellUsage(&usage);
+					subtractUsage(&usage, &before);
+					setPipelineUsage(pipeline, i, &usage);
+				}
+			}
+			else if (function || builtin)
+			{
+				/* builtin writes into a pipe, fork so the reader can run at the same time */
+				TRACE(TRACE_BEGIN, "fork", 0, "stage", i);
+				pid_t cpid = forkProcess(fd[0], fd[1], pgid);
+				if (!cpid)
+				{
+					/* pipe ends of other stages would keep readers and writers of the job waiting */
+					closeShellDescriptors(substitutions->data, substitutions->size - substitutedInput - substitutedOutput);
+					if (function)
+						initSubshell();
+
+					ret = function ? callFunction(function, nArgs, args) : builtin->function(nArgs, args);
+
+					/* exit() would also sync shell input stream and move its shared offset */
+					fflush(stdout);
+					_exit(ret);
+				}
+
+				TRACE(TRACE_END, "fork", cpid, NULL, 0);
+				if (cpid != -1)
+				{
+					addPipelineProcess(pipeline, i, cpid);
+					if (pgid == PGID_NEW)
+						pipeline->pgid = pgid = cpid;
+				}
+				else
+				{
+					fprintf(ERROR_OUTPUT, "%s: %s\n", name, strerror(errno));
+					ret = 1;
+				}
+			}
+			else
+			{
+				/* assignments before the name go only to the environment of the command */
+				char** envp = assignments ? createEnvironment(assignments) : NULL;
+				char* const* environment = envp ? envp : getEnvironment();
+
+				TRACE(TRACE_BEGIN, "spawn", 0, "stage", i);
+				int error = ENOENT;
+				const char* path = hashCommand(name);
+				pid_t cpid = path ? spawnProcess(path, args, environment, fd[0], fd[1], pgid, &error) : -1;
+				if (cpid == -1 && error == ENOENT && forgetCommand(name))
+				{
+					/* remembered location has disappeared, search $PATH again */
+					path = hashCommand(name);
+					cpid = path ? spawnProcess(path, args, environment, fd[0], fd[1], pgid, &error) : -1;
+				}
+
+				free(envp);
+
+				TRACE(TRACE_END, "spawn", cpid, "error", error);
+				/* posix_spawn returns after the child has called exec, so a pid means exec has succeeded */
+				if (cpid != -1)
+				{
+					TRACE(TRACE_INSTANT, "exec", cpid, "stage", i);
+					addPipelineProcess(pipeline, i, cpid);
+					if (pgid == PGID_NEW)
+						pipeline->pgid = pgid = cpid;
+				}
+				else
+				{
+					fprintf(ERROR_OUTPUT, "%s: %s\n", name, strerror(error));
+					ret = error == ENOENT ? 127 : 126;
+				}
+			}
+
+			setPipelineStatus(pipeline, i, ret);
+		}
+		else
+		{
+			setPipelineStatus(pipeline, i, 1);
+		}
+
+		if (infd != -1)
+			close(infd);
+
+		if (outfd != -1)
+			close(outfd);
+
+		if (prevfd != -1)
+			close(prevfd);
+
+		if (pfd[1] != -1)
+			close(pfd[1]);
+
+		prevfd = pfd[0];
+
+		if (g_exitShell && pfd[0] != -1)
+			close(pfd[0]);
+
+		for (int j = 0; j < substitutions->size; ++j)
+		{
+			if (substitutions->data[j] != -1)
+				close(substitutions->data[j]);
+		}
+
+		freeIntArray(substitutions);
+		free(args);
+		freeString(words);
+		freeWords(assignments);
+		free(input);
+		free(output);
+	}
+
+	return pipeline;
+}
+
+void runJob(const struct Job* job)
+{
+	TRACE(TRACE_BEGIN, "job", 0, "stages", job->size);
+
+	/* keep shell output in order with output of children */
+	fflush(stdout);
+
+	/* children must not be reaped before they are registered */
+	sigset_t oldMask;
+	blockChildSignal(&oldMask);
+
+	/* background job cannot read from terminal */
+	int infd = STDIN_FILENO;
+	if (job->background && !g_jobControl)
+		infd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+	struct Pipeline* pipeline = startJob(job, infd, STDOUT_FILENO, job->background);
+	if (infd != STDIN_FILENO)
+		close(infd);
+
+	if (job->background && pipeline->nRunning > 0)
+	{
+		char* text = jobToString(job);
+		int id = addBackgroundJob(pipeline, text);
+		free(text);
+
+		for (int i = 0; i < pipeline->size; ++i)
+		{
+			if (pipeline->pids[i] != -1)
+				g_lastBackgroundPid = pipeline->pids[i];
+		}
+
+		/* scripts and "-c" keep their output clean, as bash does */
+		if (g_jobControl)
+			printf("[%d] %d\n", id, g_lastBackgroundPid);
+
+		g_lastStatus = 0;
+	}
+	else
+	{
+		TRACE(TRACE_BEGIN, "wait", 0, "running", pipeline->nRunning);
+		g_foregroundPipeline = pipeline;
+		waitForegroundPipeline(pipeline);
+		g_foregroundPipeline = NULL;
+		TRACE(TRACE_END, "wait", 0, "stopped", pipeline->nStopped);
+
+		if (pipeline->nStopped)
+		{
+			char* text = jobToString(job);
+			int id = addBackgroundJob(pipeline, text);
+			printf("\n[%d]  %-10s%s\n", id, "Stopped", text);
+			free(text);
+
+			g_lastStatus = 128 + SIGTSTP;
+		}
+		else
+		{
+			if (pipeline->timed)
+				reportJobUsage(job, pipeline);
+
+			saveJobStatus(pipeline);
+			freePipeline(pipeline);
+		}
+	}
+
+	restoreSignalMask(&oldMask);
+	TRACE(TRACE_END, "job", 0, "status", g_lastStatus);
+}
+
+void runJobs(const struct Jobs* jobs)
+{
+	for (int i = 0; !g_exitShell && (i < jobs->size); ++i)
+		runJob(jobs->jobs[i]);
+}
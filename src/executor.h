@@ -0,0 +1,21 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "job.h"
+#include "process.h"
+
+/* pipeline the shell is waiting for at the moment */
+extern struct Pipeline* volatile g_foregroundPipeline;
+
+/* Starts every stage of the job, the first one reads from infd and the last one writes into outfd.
+ * Builtins run without fork only if the job is not async.
+ * SIGCHLD has to be blocked by the caller until the pipeline is registered. */
+struct Pipeline* startJob(const struct Job* job, int infd, int outfd, int async);
+
+/* Sets $? and PIPESTATUS from the finished pipeline. */
+void saveJobStatus(const struct Pipeline* pipeline);
+
+void runJob(const struct Job* job);
+void runJobs(const struct Jobs* jobs);
+
+#endif
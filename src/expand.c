@@ -0,0 +1,245 @@
+#include "expand.h"
+#include "glob.h"
+#include "utils.h"
+#include "variables.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+extern int g_lastStatus;
+extern struct IntArray* g_pipeStatus;
+extern pid_t g_lastBackgroundPid;
+extern struct StringArray* g_positionalArgs;
+
+static void addText(struct String* s, const char* text)
+{
+	while (*text)
+		addSymbol(s, *text++);
+}
+
+static void addNumber(struct String* s, int value)
+{
+	char number[16];
+	snprintf(number, sizeof(number), "%d", value);
+	addText(s, number);
+}
+
+static void addPipeStatus(struct String* s, const char* index, int length)
+{
+	if (length == 1 && (*index == '@' || *index == '*'))
+	{
+		for (int i = 0; i < g_pipeStatus->size; ++i)
+		{
+			if (i)
+				addSymbol(s, ' ');
+
+			addNumber(s, g_pipeStatus->data[i]);
+		}
+
+		return;
+	}
+
+	int n = 0;
+	for (int i = 0; i < length; ++i)
+	{
+		if (!isdigit(index[i]))
+			return;
+
+		n = n * 10 + (index[i] - '0');
+	}
+
+	if (n < g_pipeStatus->size)
+		addNumber(s, g_pipeStatus->data[n]);
+}
+
+static void addParameter(struct String* s, const char* name, int length)
+{
+	if (length == 1 && *name == '?')
+	{
+		addNumber(s, g_lastStatus);
+	}
+	else if (isdigit(*name))
+	{
+		int n = 0;
+		for (int i = 0; i < length && isdigit(name[i]); ++i)
+			n = n * 10 + (name[i] - '0');
+
+		if (n < g_positionalArgs->size)
+			addText(s, g_positionalArgs->data[n]);
+	}
+	else if (length == 1 && (*name == '@' || *name == '*'))
+	{
+		for (int i = 1; i < g_positionalArgs->size; ++i)
+		{
+			if (i > 1)
+				addSymbol(s, ' ');
+
+			addText(s, g_positionalArgs->data[i]);
+		}
+	}
+	else if (length == 1 && *name == '#')
+	{
+		addNumber(s, max(g_positionalArgs->size - 1, 0));
+	}
+	else if (length == 1 && *name == '!')
+	{
+		if (g_lastBackgroundPid)
+			addNumber(s, g_lastBackgroundPid);
+	}
+	else if (length >= 10 && !strncmp(name, "PIPESTATUS", 10) && (length == 10 || name[10] == '['))
+	{
+		if (length == 10)
+			addPipeStatus(s, "0", 1);
+		else if (name[length - 1] == ']')
+			addPipeStatus(s, name + 11, length - 12);
+	}
+	else
+	{
+		const char* value = findVariable(name, length);
+		if (value)
+			addText(s, value);
+	}
+}
+
+/* returns pointer to the first symbol after parameter, or NULL if it is not a parameter */
+static const char* parseParameter(const char* curr, const char** name, int* length)
+{
+	if (*curr == '{')
+	{
+		const char* end = strchr(curr, '}');
+		if (!end)
+			return NULL;
+
+		*name = curr + 1;
+		*length = (int)(end - curr - 1);
+		return end + 1;
+	}
+
+	if (*curr == '?' || *curr == '!' || *curr == '#' || *curr == '@' || *curr == '*' || isdigit(*curr))
+	{
+		*name = curr;
+		*length = 1;
+		return curr + 1;
+	}
+
+	const char* end = curr;
+	while (isalnum(*end) || *end == '_')
+		++end;
+
+	if (end == curr)
+		return NULL;
+
+	*name = curr;
+	*length = (int)(end - curr);
+	return end;
+}
+
+/* appends the word with all marked parameters replaced by their values */
+static void addExpandedText(struct String* s, const char* curr)
+{
+	while (*curr)
+	{
+		if (*curr != EXPANSION_MARK)
+		{
+			addSymbol(s, *curr++);
+			continue;
+		}
+
+		++curr;
+
+		const char* name;
+		int length;
+		const char* next = parseParameter(curr, &name, &length);
+		if (!next)
+		{
+			/* not a parameter, keep dollar sign as is */
+			addSymbol(s, '$');
+			continue;
+		}
+
+		addParameter(s, name, length);
+		curr = next;
+	}
+}
+
+/* removes marks in place, returns new length of the word */
+static int removeGlobMarks(char* word)
+{
+	char* out = word;
+	for (const char* curr = word; *curr; ++curr)
+	{
+		if (*curr != GLOB_MARK)
+			*out++ = *curr;
+	}
+
+	*out = '\0';
+	return (int)(out - word);
+}
+
+char* expandWord(struct StringView view)
+{
+	char* word = viewToString(view);
+	if (!word)
+		return NULL;
+
+	if (memchr(view.data, EXPANSION_MARK, (size_t)view.size))
+	{
+		struct String* s = createString();
+		addExpandedText(s, word);
+		free(word);
+		word = duplicateString(s->data);
+		freeString(s);
+	}
+
+	removeGlobMarks(word);
+	return word;
+}
+
+int expandArgument(struct StringView view, struct String* words, struct IntArray* offsets)
+{
+	if (!view.data)
+		return 0;
+
+	if (view.size == 2 && view.data[0] == EXPANSION_MARK && view.data[1] == '@')
+	{
+		/* "$@" is a separate word for every positional parameter */
+		for (int i = 1; i < g_positionalArgs->size; ++i)
+		{
+			addInt(offsets, words->size);
+			addSymbols(words, g_positionalArgs->data[i], (int)strlen(g_positionalArgs->data[i]) + 1);
+		}
+
+		return g_positionalArgs->size - 1;
+	}
+
+	char* word = viewToString(view);
+	int start = words->size;
+	addExpandedText(words, word);
+	free(word);
+
+	int size = words->size - start;
+	if (memchr(words->data + start, GLOB_MARK, (size_t)size))
+	{
+		char* pattern = duplicateString(words->data + start);
+		words->size = start;
+		int nMatches = expandGlob(pattern, words, offsets);
+		if (nMatches)
+		{
+			free(pattern);
+			return nMatches;
+		}
+
+		/* pattern without matches stays as is */
+		addSymbols(words, pattern, size);
+		free(pattern);
+	}
+
+	size = removeGlobMarks(words->data + start);
+	words->size = start + size;
+	addSymbol(words, '\0');
+	addInt(offsets, start);
+	return 1;
+}
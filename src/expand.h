@@ -0,0 +1,19 @@
+#ifndef EXPAND_H
+#define EXPAND_H
+
+/* Parser replaces every '$' which has to be expanded with this mark,
+ * expansion itself is done right before the command is run. */
+#define EXPANSION_MARK '\001'
+
+#include "utils.h"
+
+/* Returns new string with all marked parameters replaced by their values,
+ * NULL for a missing word. */
+char* expandWord(struct StringView word);
+
+/* Expands parameters and then the pattern if the word has one. Appends resulting
+ * words to words (each one followed by '\0') and their offsets to offsets.
+ * Pattern without matches is kept as a single word. Returns number of words. */
+int expandArgument(struct StringView word, struct String* words, struct IntArray* offsets);
+
+#endif
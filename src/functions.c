@@ -0,0 +1,133 @@
+#include "executor.h"
+#include "functions.h"
+#include "optimizer.h"
+#include "parsecache.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+extern int g_lastStatus;
+extern struct StringArray* g_positionalArgs;
+
+/* calls deeper than that are most likely endless recursion */
+#define MAX_FUNCTION_DEPTH 1000
+
+struct Function
+{
+	char* text; /* kept to parse the body again when the tree becomes stale */
+	struct ParsedLine* body;
+};
+
+static struct HashTable* g_functions = NULL;
+static int g_depth = 0;
+static int g_functionsVersion = 0;
+
+static void freeFunction(void* value)
+{
+	struct Function* function = value;
+	releaseParsedLine(function->body);
+	free(function->text);
+	free(function);
+}
+
+void initFunctions()
+{
+	g_functions = createHashTable(freeFunction);
+}
+
+void freeFunctions()
+{
+	freeHashTable(g_functions);
+	g_functions = NULL;
+}
+
+int defineFunction(const char* name, struct StringView body)
+{
+	char* text = viewToString(body);
+	struct ParsedLine* line = acquireParsedLine(text);
+	if (!line)
+	{
+		free(text);
+		return 1;
+	}
+
+	struct Function* function = malloc(sizeof(struct Function));
+	if (!function)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	/* trees optimized before may have rewritten a command which is a function now */
+	if (isRewrittenCommand(name) && !findFunction(name))
+		g_functionsVersion++;
+
+	function->text = text;
+	function->body = line;
+	setHashTableValue(g_functions, name, function);
+	return 0;
+}
+
+int unsetFunction(const char* name)
+{
+	if (!removeHashTableValue(g_functions, name))
+		return 0;
+
+	if (isRewrittenCommand(name))
+		g_functionsVersion++;
+
+	return 1;
+}
+
+int getFunctionsVersion()
+{
+	return g_functionsVersion;
+}
+
+struct Function* findFunction(const char* name)
+{
+	return g_functions && g_functions->size ? getHashTableValue(g_functions, name) : NULL;
+}
+
+int callFunction(struct Function* function, int argc, char** argv)
+{
+	if (g_depth == MAX_FUNCTION_DEPTH)
+	{
+		fprintf(ERROR_OUTPUT, "%s: maximum function nesting level exceeded (%d)\n", argv[0], MAX_FUNCTION_DEPTH);
+		return 1;
+	}
+
+	if (!isParsedLineCurrent(function->body))
+	{
+		/* the optimizer may have replaced "cat" which is a function now, or the other way round */
+		struct ParsedLine* line = acquireParsedLine(function->text);
+		if (line)
+		{
+			releaseParsedLine(function->body);
+			function->body = line;
+		}
+	}
+
+	/* body may redefine or unset the function while it runs */
+	struct ParsedLine* body = function->body;
+	retainParsedLine(body);
+
+	struct StringArray* savedArgs = g_positionalArgs;
+	g_positionalArgs = createStringArray();
+	addString(g_positionalArgs, savedArgs->data[0]);
+	for (int i = 1; i < argc; ++i)
+		addString(g_positionalArgs, argv[i]);
+
+	g_depth++;
+	g_lastStatus = 0;
+	printPlan(body->jobs);
+	runJobs(body->jobs);
+	g_depth--;
+
+	freeStringArray(g_positionalArgs);
+	g_positionalArgs = savedArgs;
+	releaseParsedLine(body);
+	return g_lastStatus;
+}
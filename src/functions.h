@@ -0,0 +1,30 @@
+#ifndef FUNCTIONS_H
+#define FUNCTIONS_H
+
+#include "utils.h"
+
+/* Shell functions defined with "name() { body; }". The body is parsed once
+ * when the definition runs, every call runs the stored tree while it is current. */
+
+struct Function;
+
+void initFunctions();
+void freeFunctions();
+
+/* Returns 1 if the body has a syntax error. */
+int defineFunction(const char* name, struct StringView body);
+/* Returns 1 if the function was defined. */
+int unsetFunction(const char* name);
+
+/* Changes every time a function which the optimizer would replace is defined or removed,
+ * parse trees built before it are stale. */
+int getFunctionsVersion();
+
+/* Returns NULL if there is no function with such name. */
+struct Function* findFunction(const char* name);
+
+/* Runs the body with argv[1..] as positional parameters, returns status of the last job.
+ * A body optimized before "cat" became or stopped being a function is parsed again. */
+int callFunction(struct Function* function, int argc, char** argv);
+
+#endif
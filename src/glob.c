@@ -0,0 +1,433 @@
+#define _GNU_SOURCE
+
+#include "glob.h"
+#include "utils.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define DIRENT_BUFFER_SIZE (256 * 1024)
+
+struct Listing
+{
+	struct String* names;     /* names separated by '\0' */
+	struct IntArray* offsets; /* start of every name */
+	struct String* types;     /* d_type of every name */
+	struct timespec mtime;
+	dev_t dev;
+	ino_t ino;
+	int generation; /* expandGlob call which has checked the listing last */
+};
+
+struct Glob
+{
+	struct StringView* components;
+	int nComponents;
+	struct String* path; /* directory being matched, ends with '/' unless empty */
+	struct String* words;
+	struct IntArray* offsets;
+};
+
+/* listings by directory path */
+static struct HashTable* g_listings = NULL;
+static int g_generation = 0;
+
+static void freeListing(void* value)
+{
+	struct Listing* listing = value;
+	freeString(listing->names);
+	freeIntArray(listing->offsets);
+	freeString(listing->types);
+	free(listing);
+}
+
+void clearGlobCache()
+{
+	freeHashTable(g_listings);
+	g_listings = NULL;
+}
+
+static struct Listing* readListing(const char* path, const struct stat* st)
+{
+	int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1)
+		return NULL;
+
+	struct Listing* listing = malloc(sizeof(struct Listing));
+	char* buffer = malloc(DIRENT_BUFFER_SIZE);
+	if (!listing || !buffer)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	listing->names = createString();
+	listing->offsets = createIntArray();
+	listing->types = createString();
+	listing->mtime = st->st_mtim;
+	listing->dev = st->st_dev;
+	listing->ino = st->st_ino;
+
+	/* one call returns thousands of entries */
+	ssize_t size;
+	while ((size = getdents64(fd, buffer, DIRENT_BUFFER_SIZE)) > 0)
+	{
+		for (ssize_t position = 0; position < size;)
+		{
+			const struct dirent64* entry = (const struct dirent64*)(buffer + position);
+			position += entry->d_reclen;
+
+			const char* name = entry->d_name;
+			if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+				continue;
+
+			addInt(listing->offsets, listing->names->size);
+			addSymbols(listing->names, name, (int)strlen(name) + 1);
+			addSymbol(listing->types, (char)entry->d_type);
+		}
+	}
+
+	free(buffer);
+	close(fd);
+	return listing;
+}
+
+static const struct Listing* getListing(const char* path)
+{
+	if (!g_listings)
+		g_listings = createHashTable(freeListing);
+
+	/* checked once per pattern, so a listing in use is never replaced */
+	struct Listing* listing = getHashTableValue(g_listings, path);
+	if (listing && listing->generation == g_generation)
+		return listing;
+
+	struct stat st;
+	if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode))
+		return NULL;
+
+	/* listing is read again if the directory has changed since */
+	if (!listing || listing->dev != st.st_dev || listing->ino != st.st_ino
+		|| listing->mtime.tv_sec != st.st_mtim.tv_sec || listing->mtime.tv_nsec != st.st_mtim.tv_nsec)
+	{
+		listing = readListing(path, &st);
+		if (listing)
+			setHashTableValue(g_listings, path, listing);
+		else
+			removeHashTableValue(g_listings, path);
+	}
+
+	if (listing)
+		listing->generation = g_generation;
+
+	return listing;
+}
+
+static int isActive(const char* symbol, const char* end)
+{
+	return *symbol == GLOB_MARK && symbol + 1 < end;
+}
+
+static int hasActiveSymbols(struct StringView component)
+{
+	return memchr(component.data, GLOB_MARK, (size_t)component.size) != NULL;
+}
+
+/* "[...]", pattern points after '['. Returns end of the bracket or NULL if it is not closed. */
+static const char* matchBracket(const char* pattern, const char* end, char symbol, int* matched)
+{
+	const char* curr = pattern;
+	int negate = 0;
+	if (curr < end && (*curr == '!' || *curr == '^'))
+	{
+		negate = 1;
+		++curr;
+	}
+
+	*matched = 0;
+	int first = 1;
+	while (curr < end)
+	{
+		/* marks of symbols inside brackets do not matter */
+		if (*curr == GLOB_MARK)
+		{
+			++curr;
+			continue;
+		}
+
+		if (*curr == ']' && !first)
+		{
+			*matched = *matched != negate;
+			return curr + 1;
+		}
+
+		char low = *curr;
+		char high = low;
+		if (curr + 2 < end && curr[1] == '-' && curr[2] != ']')
+		{
+			high = curr[2];
+			curr += 2;
+		}
+
+		if ((unsigned char)symbol >= (unsigned char)low && (unsigned char)symbol <= (unsigned char)high)
+			*matched = 1;
+
+		++curr;
+		first = 0;
+	}
+
+	return NULL;
+}
+
+/* matches one symbol of the name, returns the rest of the pattern */
+static const char* matchSymbol(const char* pattern, const char* end, char symbol, int* matched)
+{
+	if (isActive(pattern, end))
+	{
+		if (pattern[1] == '?')
+		{
+			*matched = 1;
+			return pattern + 2;
+		}
+
+		if (pattern[1] == '[')
+		{
+			const char* next = matchBracket(pattern + 2, end, symbol, matched);
+			if (next)
+				return next;
+
+			/* not closed, so it is a usual symbol */
+			*matched = symbol == '[';
+			return pattern + 2;
+		}
+	}
+
+	*matched = *pattern == symbol;
+	return pattern + 1;
+}
+
+static int isStar(const char* pattern, const char* end)
+{
+	return isActive(pattern, end) && pattern[1] == '*';
+}
+
+static int matchName(struct StringView component, const char* name)
+{
+	const char* pattern = component.data;
+	const char* end = pattern + component.size;
+
+	/* hidden files are matched only by a pattern which starts with '.' */
+	if (*name == '.' && *pattern != '.')
+		return 0;
+
+	/* on mismatch the last star takes one more symbol */
+	const char* starPattern = NULL;
+	const char* starName = NULL;
+	while (*name)
+	{
+		if (pattern < end && isStar(pattern, end))
+		{
+			pattern += 2;
+			starPattern = pattern;
+			starName = name;
+			continue;
+		}
+
+		int matched = 0;
+		const char* next = pattern < end ? matchSymbol(pattern, end, *name, &matched) : NULL;
+		if (matched)
+		{
+			pattern = next;
+			++name;
+		}
+		else if (starPattern)
+		{
+			pattern = starPattern;
+			name = ++starName;
+		}
+		else
+		{
+			return 0;
+		}
+	}
+
+	while (pattern < end && isStar(pattern, end))
+		pattern += 2;
+
+	return pattern == end;
+}
+
+static int isDoubleStar(struct StringView component)
+{
+	return component.size == 4 && isStar(component.data, component.data + 4) && isStar(component.data + 2, component.data + 4);
+}
+
+static void addMatch(struct Glob* glob)
+{
+	addInt(glob->offsets, glob->words->size);
+	addSymbols(glob->words, glob->path->data, glob->path->size);
+	addSymbol(glob->words, '\0');
+}
+
+static void truncatePath(struct Glob* glob, int size)
+{
+	glob->path->size = size;
+	glob->path->data[size] = '\0';
+}
+
+static int isDirectory(struct Glob* glob, char type, int follow)
+{
+	if (type == DT_DIR)
+		return 1;
+
+	if (type != DT_UNKNOWN && (type != DT_LNK || !follow))
+		return 0;
+
+	struct stat st;
+	int ret = follow ? stat(glob->path->data, &st) : lstat(glob->path->data, &st);
+	return !ret && S_ISDIR(st.st_mode);
+}
+
+static void matchComponent(struct Glob* glob, int index);
+
+/* "**": the rest of the pattern is matched in the directory and in all its subdirectories */
+static void matchDirectories(struct Glob* glob, int index, const struct Listing* listing)
+{
+	int last = index == glob->nComponents - 1;
+	if (!last)
+		matchComponent(glob, index + 1);
+
+	int pathSize = glob->path->size;
+	for (int i = 0; listing && i < listing->offsets->size; ++i)
+	{
+		const char* name = listing->names->data + listing->offsets->data[i];
+		if (*name == '.')
+			continue;
+
+		addSymbols(glob->path, name, (int)strlen(name));
+		if (last)
+			addMatch(glob);
+
+		/* symbolic links are not followed, so there are no loops */
+		if (isDirectory(glob, listing->types->data[i], 0))
+		{
+			addSymbol(glob->path, '/');
+			matchDirectories(glob, index, getListing(glob->path->data));
+		}
+
+		truncatePath(glob, pathSize);
+	}
+}
+
+static void matchComponent(struct Glob* glob, int index)
+{
+	int last = index == glob->nComponents - 1;
+	struct StringView component = glob->components[index];
+	int pathSize = glob->path->size;
+	const char* directory = pathSize ? glob->path->data : ".";
+
+	if (!hasActiveSymbols(component))
+	{
+		/* no need to read the directory */
+		addSymbols(glob->path, component.data, component.size);
+		if (!last)
+		{
+			addSymbol(glob->path, '/');
+			matchComponent(glob, index + 1);
+		}
+		else if (!access(glob->path->data, F_OK))
+		{
+			addMatch(glob);
+		}
+
+		truncatePath(glob, pathSize);
+		return;
+	}
+
+	const struct Listing* listing = getListing(directory);
+	if (isDoubleStar(component))
+	{
+		matchDirectories(glob, index, listing);
+		return;
+	}
+
+	for (int i = 0; listing && i < listing->offsets->size; ++i)
+	{
+		const char* name = listing->names->data + listing->offsets->data[i];
+		if (!matchName(component, name))
+			continue;
+
+		addSymbols(glob->path, name, (int)strlen(name));
+		if (last)
+		{
+			addMatch(glob);
+		}
+		else if (isDirectory(glob, listing->types->data[i], 1))
+		{
+			addSymbol(glob->path, '/');
+			matchComponent(glob, index + 1);
+		}
+
+		truncatePath(glob, pathSize);
+	}
+}
+
+static int compareMatches(const void* left, const void* right, void* words)
+{
+	return strcmp((const char*)words + *(const int*)left, (const char*)words + *(const int*)right);
+}
+
+int expandGlob(const char* pattern, struct String* words, struct IntArray* offsets)
+{
+	struct Glob glob;
+	glob.path = createString();
+	glob.words = words;
+	glob.offsets = offsets;
+	glob.nComponents = 1;
+	for (const char* curr = pattern; *curr; ++curr)
+		glob.nComponents += *curr == '/';
+
+	glob.components = malloc((size_t)glob.nComponents * sizeof(struct StringView));
+	glob.nComponents = 0;
+
+	const char* curr = pattern;
+	if (*curr == '/')
+	{
+		addSymbol(glob.path, '/');
+		while (*curr == '/')
+			++curr;
+	}
+
+	while (1)
+	{
+		const char* slash = strchr(curr, '/');
+		int size = slash ? (int)(slash - curr) : (int)strlen(curr);
+		glob.components[glob.nComponents].data = curr;
+		glob.components[glob.nComponents].size = size;
+		glob.nComponents++;
+
+		if (!slash)
+			break;
+
+		curr = slash + 1;
+	}
+
+	int firstMatch = offsets->size;
+	g_generation++;
+	matchComponent(&glob, 0);
+
+	/* matches are sorted in place, only their offsets move */
+	int nMatches = offsets->size - firstMatch;
+	qsort_r(offsets->data + firstMatch, (size_t)nMatches, sizeof(int), compareMatches, words->data);
+
+	free(glob.components);
+	freeString(glob.path);
+	return nMatches;
+}
@@ -0,0 +1,20 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include "utils.h"
+
+/* Parser puts this mark before every unquoted '*', '?' and '[',
+ * only marked symbols are special in a pattern. */
+#define GLOB_MARK '\002'
+
+/* Appends paths matching the pattern to words (each one followed by '\0')
+ * and their offsets to offsets, sorted by name. Supports '*', '?', '[...]'
+ * and "**" which matches any number of directories.
+ * Returns number of matches. */
+int expandGlob(const char* pattern, struct String* words, struct IntArray* offsets);
+
+/* Directory listings are cached until this is called, every listing
+ * is still checked against modification time of the directory. */
+void clearGlobCache();
+
+#endif
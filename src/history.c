@@ -0,0 +1,709 @@
+#define _GNU_SOURCE
+
+#include "history.h"
+#include "parser.h"
+#include "trace.h"
+#include "utils.h"
+#include "variables.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define DEFAULT_HISTSIZE 500
+#define HISTORY_FILE_NAME ".shell_history"
+
+#define MIN_ARRAY_SIZE 64
+
+#define TRIGRAM_SIZE 3
+
+/* commands from history are expanded too, this limits references to references */
+#define MAX_EXPANSION_DEPTH 16
+
+static int getLimit(const char* name, int defaultValue)
+{
+	const char* value = getVariable(name);
+	if (!value || !isdigit((unsigned char)*value))
+		return defaultValue;
+
+	return atoi(value);
+}
+
+static int getHistorySizeLimit()
+{
+	return getLimit("HISTSIZE", DEFAULT_HISTSIZE);
+}
+
+static int getHistoryFileLimit()
+{
+	return getLimit("HISTFILESIZE", getHistorySizeLimit());
+}
+
+/* new line escaped with odd number of slashes is a part of the entry */
+static int isContinuation(const char* begin, const char* newLine)
+{
+	int nSlashes = 0;
+	for (const char* curr = newLine; curr > begin && *(curr - 1) == '\\'; --curr)
+		++nSlashes;
+
+	return nSlashes % 2;
+}
+
+/* Returns start of the last maxEntries non-empty entries of the text, *count gets their number. */
+static const char* findLastEntries(const char* data, size_t size, int maxEntries, int* count)
+{
+	const char* start = data + size;
+	*count = 0;
+	while (start > data && *count < maxEntries)
+	{
+		/* last symbol of the previous entry, usually the new line terminating it */
+		const char* last = start - 1;
+		const char* newLine = last;
+		do
+			newLine = memrchr(data, '\n', (size_t)(newLine - data));
+		while (newLine && isContinuation(data, newLine));
+
+		start = newLine ? newLine + 1 : data;
+		if (start < last || (start == last && *last != '\n'))
+			++*count;
+	}
+
+	return start;
+}
+
+static void addEntryView(struct History* history, const char* data, int size)
+{
+	if (history->size == history->capacity)
+	{
+		int newCapacity = max(history->capacity * 2, MIN_ARRAY_SIZE);
+		history->entries = realloc(history->entries, (size_t)newCapacity * sizeof(struct StringView));
+		if (!history->entries)
+		{
+			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+			exit(1);
+		}
+
+		history->capacity = newCapacity;
+	}
+
+	history->entries[history->size].data = data;
+	history->entries[history->size].size = size;
+	history->size++;
+}
+
+/* New lines inside an entry (here-documents, function bodies, escaped new lines) are written
+ * with 2k + 1 slashes before them, k being the number of slashes they had. So every one of them
+ * is a continuation in the file and the entry can be restored exactly. */
+static void encodeEntry(struct String* s, const char* data, int size)
+{
+	int nSlashes = 0;
+	for (int i = 0; i < size; ++i)
+	{
+		if (data[i] == '\n')
+		{
+			for (int j = 0; j < nSlashes + 1; ++j)
+				addSymbol(s, '\\');
+		}
+
+		nSlashes = data[i] == '\\' ? nSlashes + 1 : 0;
+		addSymbol(s, data[i]);
+	}
+}
+
+/* Returns copy of the encoded entry followed by '\n', like the entries added in the session. */
+static struct StringView decodeEntry(struct History* history, const char* data, int size)
+{
+	char* entry = allocateFromArena(history->arena, (size_t)size + 1);
+	int entrySize = 0;
+	int nSlashes = 0;
+	for (int i = 0; i < size; ++i)
+	{
+		if (data[i] == '\n')
+			entrySize -= nSlashes - (nSlashes - 1) / 2;
+
+		nSlashes = data[i] == '\\' ? nSlashes + 1 : 0;
+		entry[entrySize++] = data[i];
+	}
+
+	entry[entrySize] = '\n';
+	struct StringView view = { entry, entrySize };
+	return view;
+}
+
+static void loadEntries(struct History* history, const char* data, const char* end)
+{
+	while (data < end)
+	{
+		const char* newLine = memchr(data, '\n', (size_t)(end - data));
+		int multiline = 0;
+		while (newLine && isContinuation(data, newLine))
+		{
+			multiline = 1;
+			newLine = memchr(newLine + 1, '\n', (size_t)(end - newLine - 1));
+		}
+
+		const char* entryEnd = newLine ? newLine : end;
+		if (multiline)
+		{
+			/* only such entries are copied, the rest stay in the mapping */
+			struct StringView entry = decodeEntry(history, data, (int)(entryEnd - data));
+			addEntryView(history, entry.data, entry.size);
+		}
+		else if (entryEnd > data)
+		{
+			addEntryView(history, data, (int)(entryEnd - data));
+		}
+
+		data = newLine ? newLine + 1 : end;
+	}
+}
+
+static int isMapped(const struct History* history, const char* data)
+{
+	return history->map && data >= history->map && data < history->map + history->mapSize;
+}
+
+static void freeTrigramList(void* list)
+{
+	freeIntArray(list);
+}
+
+static void makeTrigramKey(char key[TRIGRAM_SIZE + 1], const char* data)
+{
+	memcpy(key, data, TRIGRAM_SIZE);
+	key[TRIGRAM_SIZE] = '\0';
+}
+
+/* returns index of the first number in the sorted list which is not less than value */
+static int findLowerBound(const struct IntArray* list, int value)
+{
+	int left = 0, right = list->size;
+	while (left < right)
+	{
+		int middle = left + (right - left) / 2;
+		if (list->data[middle] < value)
+			left = middle + 1;
+		else
+			right = middle;
+	}
+
+	return left;
+}
+
+static void indexEntry(struct History* history, int number, const struct StringView* entry)
+{
+	char key[TRIGRAM_SIZE + 1];
+	for (int i = 0; i + TRIGRAM_SIZE <= entry->size; ++i)
+	{
+		makeTrigramKey(key, entry->data + i);
+		struct IntArray* list = getHashTableValue(history->trigrams, key);
+		if (!list)
+		{
+			list = createIntArray();
+			setHashTableValue(history->trigrams, key, list);
+		}
+
+		/* entry is added once even if the trigram repeats */
+		if (!list->size || list->data[list->size - 1] != number)
+			addInt(list, number);
+	}
+}
+
+static void updateHistoryIndex(struct History* history)
+{
+	if (!history->trigrams)
+		history->trigrams = createHashTable(freeTrigramList);
+
+	int number = max(history->lastIndexed + 1, getFirstHistoryNumber(history));
+	for (; number <= getLastHistoryNumber(history); ++number)
+		indexEntry(history, number, getHistoryEntry(history, number));
+
+	history->lastIndexed = getLastHistoryNumber(history);
+}
+
+/* removes numbers of hidden entries from the index */
+static void pruneHistoryIndex(struct History* history)
+{
+	if (!history->trigrams)
+		return;
+
+	int first = getFirstHistoryNumber(history);
+	for (int i = 0; i < history->trigrams->capacity; ++i)
+	{
+		for (struct HashEntry* entry = history->trigrams->buckets[i]; entry; entry = entry->next)
+		{
+			struct IntArray* list = entry->value;
+			int nHidden = findLowerBound(list, first);
+			memmove(list->data, list->data + nHidden, (size_t)(list->size - nHidden) * sizeof(int));
+			list->size -= nHidden;
+		}
+	}
+}
+
+/* drops hidden entries and memory they use */
+static void compactHistory(struct History* history)
+{
+	struct Arena* arena = createArena();
+	int nMapped = 0;
+	for (int i = history->first; i < history->size; ++i)
+	{
+		struct StringView entry = history->entries[i];
+		if (isMapped(history, entry.data))
+		{
+			++nMapped;
+		}
+		else
+		{
+			/* keep the new line, so the entry can still be written at once */
+			char* copy = allocateFromArena(arena, (size_t)entry.size + 1);
+			memcpy(copy, entry.data, (size_t)entry.size + 1);
+			entry.data = copy;
+		}
+
+		history->entries[i - history->first] = entry;
+	}
+
+	history->offset += history->first;
+	history->size -= history->first;
+	history->first = 0;
+
+	freeArena(history->arena);
+	history->arena = arena;
+
+	if (!nMapped && history->map)
+	{
+		munmap((void*)history->map, history->mapSize);
+		history->map = NULL;
+		history->mapSize = 0;
+	}
+
+	pruneHistoryIndex(history);
+}
+
+static void trimHistory(struct History* history)
+{
+	int limit = getHistorySizeLimit();
+	if (history->size - history->first > limit)
+		history->first = history->size - limit;
+
+	/* hidden entries are released when there are as many of them as visible ones */
+	if (history->first > 0 && history->first >= history->size - history->first)
+		compactHistory(history);
+}
+
+struct History* createHistory()
+{
+	struct History* history = malloc(sizeof(struct History));
+	if (!history)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	memset(history, 0, sizeof(struct History));
+	history->arena = createArena();
+	history->fd = -1;
+	return history;
+}
+
+void freeHistory(struct History* history)
+{
+	if (!history)
+		return;
+
+	if (history->fd != -1)
+		close(history->fd);
+
+	if (history->map)
+		munmap((void*)history->map, history->mapSize);
+
+	freeHashTable(history->trigrams);
+	freeArena(history->arena);
+	free(history->entries);
+	free(history->path);
+	free(history);
+}
+
+char* getHistoryFilePath()
+{
+	const char* path = getVariable("HISTFILE");
+	if (path)
+		return *path ? duplicateString(path) : NULL;
+
+	const char* home = getVariable("HOME");
+	if (!home)
+		return NULL;
+
+	size_t size = strlen(home) + sizeof(HISTORY_FILE_NAME) + 1;
+	char* ret = malloc(size);
+	snprintf(ret, size, "%s/%s", home, HISTORY_FILE_NAME);
+	return ret;
+}
+
+/* Maps whole file for reading, returns NULL if it is empty or cannot be read. */
+static const char* mapFile(const char* path, size_t* size)
+{
+	*size = 0;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return NULL;
+
+	struct stat st;
+	void* map = MAP_FAILED;
+	if (!fstat(fd, &st) && st.st_size > 0)
+		map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	*size = (size_t)st.st_size;
+	return map;
+}
+
+/* Leaves only the last maxEntries entries in the file, returns number of entries left. */
+static int cutHistoryFile(const char* path, int maxEntries)
+{
+	size_t size;
+	const char* map = mapFile(path, &size);
+	if (!map)
+		return 0;
+
+	int count;
+	const char* start = findLastEntries(map, size, maxEntries, &count);
+	if (start != map)
+	{
+		/* write a new file and replace the old one, so the history is never half-written */
+		size_t tmpSize = strlen(path) + 8;
+		char* tmpPath = malloc(tmpSize);
+		snprintf(tmpPath, tmpSize, "%s.XXXXXX", path);
+
+		int fd = mkostemp(tmpPath, O_CLOEXEC);
+		if (fd != -1)
+		{
+			int ok = !writeAll(fd, start, (int)(map + size - start));
+			close(fd);
+
+			if (!ok || rename(tmpPath, path) == -1)
+				unlink(tmpPath);
+		}
+
+		free(tmpPath);
+	}
+
+	munmap((void*)map, size);
+	return count;
+}
+
+int openHistoryFile(struct History* history, const char* path)
+{
+	history->nFileEntries = cutHistoryFile(path, getHistoryFileLimit());
+
+	/* entries stay in the mapping, only their locations are kept */
+	size_t size;
+	const char* map = mapFile(path, &size);
+	if (map)
+	{
+		int count;
+		const char* start = findLastEntries(map, size, getHistorySizeLimit(), &count);
+		history->map = map;
+		history->mapSize = size;
+		loadEntries(history, start, map + size);
+		trimHistory(history);
+	}
+
+	history->fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+	if (history->fd == -1)
+	{
+		fprintf(ERROR_OUTPUT, "history: %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	history->path = duplicateString(path);
+	return 0;
+}
+
+static void appendToHistoryFile(struct History* history, const char* entry, int size)
+{
+	/* one write per entry, O_APPEND keeps entries of several shells whole */
+	if (writeAll(history->fd, entry, size) == -1)
+		return;
+
+	history->nFileEntries++;
+
+	int limit = getHistoryFileLimit();
+	if (history->nFileEntries > 2 * limit)
+	{
+		history->nFileEntries = cutHistoryFile(history->path, limit);
+
+		/* the file was replaced */
+		close(history->fd);
+		history->fd = open(history->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+	}
+}
+
+void addHistoryEntry(struct History* history, const char* text)
+{
+	int size = (int)strlen(text);
+	if (!size)
+		return;
+
+	char* entry = allocateFromArena(history->arena, (size_t)size + 1);
+	memcpy(entry, text, (size_t)size);
+	entry[size] = '\n';
+	addEntryView(history, entry, size);
+
+	if (history->fd != -1 && memchr(text, '\n', (size_t)size))
+	{
+		struct String* encoded = createString();
+		encodeEntry(encoded, entry, size);
+		addSymbol(encoded, '\n');
+		appendToHistoryFile(history, encoded->data, encoded->size);
+		freeString(encoded);
+	}
+	else if (history->fd != -1)
+	{
+		appendToHistoryFile(history, entry, size + 1);
+	}
+
+	trimHistory(history);
+}
+
+int getFirstHistoryNumber(const struct History* history)
+{
+	return history->offset + history->first + 1;
+}
+
+int getLastHistoryNumber(const struct History* history)
+{
+	return history->offset + history->size;
+}
+
+const struct StringView* getHistoryEntry(const struct History* history, int number)
+{
+	int index = number - history->offset - 1;
+	if (index < history->first || index >= history->size)
+		return NULL;
+
+	return &history->entries[index];
+}
+
+static int isMatchingEntry(const struct StringView* entry, const char* pattern, int size, int prefix)
+{
+	if (prefix)
+		return entry->size >= size && !memcmp(entry->data, pattern, (size_t)size);
+
+	return memmem(entry->data, (size_t)entry->size, pattern, (size_t)size) != NULL;
+}
+
+int findHistoryEntry(struct History* history, const char* pattern, int size, int prefix, int before)
+{
+	int first = getFirstHistoryNumber(history);
+	before = min(before, getLastHistoryNumber(history) + 1);
+
+	if (size < TRIGRAM_SIZE)
+	{
+		/* too short for the index */
+		for (int number = before - 1; number >= first; --number)
+		{
+			if (isMatchingEntry(getHistoryEntry(history, number), pattern, size, prefix))
+				return number;
+		}
+
+		return 0;
+	}
+
+	updateHistoryIndex(history);
+
+	/* matching entry contains every trigram of the pattern, so only entries from the shortest list are checked */
+	const struct IntArray* shortest = NULL;
+	char key[TRIGRAM_SIZE + 1];
+	for (int i = 0; i + TRIGRAM_SIZE <= size; ++i)
+	{
+		makeTrigramKey(key, pattern + i);
+		const struct IntArray* list = getHashTableValue(history->trigrams, key);
+		if (!list || !list->size)
+			return 0;
+
+		if (!shortest || list->size < shortest->size)
+			shortest = list;
+	}
+
+	for (int i = findLowerBound(shortest, before) - 1; i >= 0 && shortest->data[i] >= first; --i)
+	{
+		if (isMatchingEntry(getHistoryEntry(history, shortest->data[i]), pattern, size, prefix))
+			return shortest->data[i];
+	}
+
+	return 0;
+}
+
+/* "!" followed by one of these symbols is not a reference */
+static int isReferenceEnd(char symbol)
+{
+	return symbol == '\0' || isspace((unsigned char)symbol) || strchr(";|&<>()=\"'", symbol);
+}
+
+static int readNumber(const char** text, const char* end)
+{
+	int n = 0;
+	while (*text < end && isdigit((unsigned char)**text))
+	{
+		n = min(n * 10 + (**text - '0'), 1 << 24);
+		++*text;
+	}
+
+	return n;
+}
+
+/* ref points after "!", returns the end of the reference or NULL if there is no such command */
+static const char* findReference(const char* ref, const char* end, struct History* history, const struct StringView** item)
+{
+	const char* next = ref;
+	int number = 0;
+	if (next < end && *next == '!')
+	{
+		number = getLastHistoryNumber(history);
+		++next;
+	}
+	else if (next + 1 < end && *next == '-' && isdigit((unsigned char)next[1]))
+	{
+		++next;
+		number = getLastHistoryNumber(history) + 1 - readNumber(&next, end);
+	}
+	else if (next < end && isdigit((unsigned char)*next))
+	{
+		number = readNumber(&next, end);
+	}
+	else if (next < end && *next == '?')
+	{
+		/* closing "?" can be omitted at the end of the line */
+		const char* text = ++next;
+		while (next < end && *next != '?' && *next != '\n')
+			++next;
+
+		number = findHistoryEntry(history, text, (int)(next - text), 0, getLastHistoryNumber(history) + 1);
+		if (next < end && *next == '?')
+			++next;
+	}
+	else
+	{
+		while (next < end && !isReferenceEnd(*next))
+			++next;
+
+		number = findHistoryEntry(history, ref, (int)(next - ref), 1, getLastHistoryNumber(history) + 1);
+	}
+
+	*item = getHistoryEntry(history, number);
+	if (!*item)
+	{
+		/* TODO: specify location*/
+		fprintf(ERROR_OUTPUT, "Cannot find history command \"!%.*s\". To see available history commands type \"history\".\n", (int)(next - ref), ref);
+		return NULL;
+	}
+
+	return next;
+}
+
+static int expandText(struct String* out, const char* text, const char* end, struct History* history, int depth)
+{
+	if (depth > MAX_EXPANSION_DEPTH)
+	{
+		fprintf(ERROR_OUTPUT, "History expansion is nested too deep.\n");
+		return 1;
+	}
+
+	/* text between references is copied in one piece */
+	const char* start = text;
+	const char* curr = text;
+	int escaped = 0;
+	int squotes = 0;
+	int dquotes = 0;
+	while (curr < end)
+	{
+		char nextSymbol = curr + 1 < end ? *(curr + 1) : '\0';
+		switch (*curr)
+		{
+		case '\\':
+			escaped = isEscapingSlash(squotes, dquotes, escaped, nextSymbol);
+			++curr;
+			continue;
+
+		case '\'':
+			if (!dquotes)
+				squotes = !squotes;
+
+			++curr;
+			break;
+
+		case '"':
+			if (!squotes && !escaped)
+				dquotes = !dquotes;
+
+			++curr;
+			break;
+
+		case '!':
+			/* "$!" is a parameter and "[!...]" a negated pattern, not history references */
+			if (!squotes && !escaped && (curr == text || (*(curr - 1) != '$' && *(curr - 1) != '[')) && !isReferenceEnd(nextSymbol))
+			{
+				const struct StringView* item;
+				const char* next = findReference(curr + 1, end, history, &item);
+				if (!next)
+					return 1;
+
+				addSymbols(out, start, (int)(curr - start));
+				if (expandText(out, item->data, item->data + item->size, history, depth + 1))
+					return 1;
+
+				start = curr = next;
+				escaped = 0;
+				continue;
+			}
+
+			++curr;
+			break;
+
+		default:
+			++curr;
+			break;
+		}
+
+		escaped = 0;
+	}
+
+	addSymbols(out, start, (int)(curr - start));
+	return 0;
+}
+
+char* expandHistory(const char* text, struct History* history)
+{
+	return expandHistoryPrefix(text, (int)strlen(text), history);
+}
+
+char* expandHistoryPrefix(const char* text, int size, struct History* history)
+{
+	TRACE(TRACE_BEGIN, "history", 0, "size", size);
+
+	struct String* out = createString();
+	char* ret = NULL;
+	if (!expandText(out, text, text + size, history, 0))
+	{
+		addSymbols(out, text + size, (int)strlen(text + size));
+		ret = out->data;
+		out->data = NULL;
+	}
+
+	freeString(out);
+
+	TRACE(TRACE_END, "history", 0, "expanded", ret != NULL);
+	return ret;
+}
@@ -0,0 +1,70 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "utils.h"
+
+#include <stddef.h>
+
+/* History of command lines, see "history" in bash.
+ * At most $HISTSIZE (500 by default) last lines are visible. If a history file
+ * is opened, every line is appended to it and the file is cut down to the last
+ * $HISTFILESIZE (same as $HISTSIZE by default) lines when it grows twice as big.
+ * New lines inside an entry are escaped in the file, so multi-line commands stay one entry. */
+struct History
+{
+	struct StringView* entries; /* visible entries start at index first */
+	int size;
+	int capacity;
+	int first;
+	int offset; /* entries[i] has number offset + i + 1 */
+
+	struct Arena* arena; /* entries added in this session, each one followed by '\n' */
+	const char* map;     /* entries loaded from the file */
+	size_t mapSize;
+
+	char* path;
+	int fd;
+	int nFileEntries;
+
+	/* numbers of entries containing every three symbols, in ascending order,
+	 * updated before a search with entries added since the previous one */
+	struct HashTable* trigrams;
+	int lastIndexed;
+};
+
+struct History* createHistory();
+void freeHistory(struct History* history);
+
+/* Loads last entries of the file and appends new entries to it.
+ * Returns 0 on success. */
+int openHistoryFile(struct History* history, const char* path);
+
+/* Default location of the history file: $HISTFILE or ~/.shell_history, NULL if disabled. */
+char* getHistoryFilePath();
+
+/* Empty lines are not added. */
+void addHistoryEntry(struct History* history, const char* text);
+
+int getFirstHistoryNumber(const struct History* history);
+int getLastHistoryNumber(const struct History* history);
+
+/* Returns NULL if there is no entry with such number. */
+const struct StringView* getHistoryEntry(const struct History* history, int number);
+
+/* Returns number of the newest entry before the given number which contains pattern
+ * (or starts with it if prefix is set), 0 if there is none. */
+int findHistoryEntry(struct History* history, const char* pattern, int size, int prefix, int before);
+
+/* Replaces history references in the line with commands from history:
+ *   !N       N-th command
+ *   !-N      N-th command from the end
+ *   !!       previous command, same as !-1
+ *   !prefix  last command starting with prefix
+ *   !?text?  last command containing text
+ * Returns new string or NULL (with a message printed) if a reference cannot be found. */
+char* expandHistory(const char* text, struct History* history);
+/* References are searched only in the first size bytes, the rest of the text is copied as is
+ * (e.g. lines of a here-document). */
+char* expandHistoryPrefix(const char* text, int size, struct History* history);
+
+#endif
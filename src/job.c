@@ -1,7 +1,10 @@
+#include "expand.h"
+#include "glob.h"
 #include "job.h"
 #include "utils.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 extern struct _IO_FILE* ERROR_OUTPUT;
 
@@ -9,25 +12,35 @@ extern struct _IO_FILE* ERROR_OUTPUT;
 #define MAX_ARRAY_GROW_SIZE 64
 #define ARRAY_GROWTH_FACTOR 1.5
 
-struct Command* createCommand()
+struct Command* createCommand(struct Arena* arena)
 {
-	struct Command* command = malloc(sizeof(struct Command));
-	command->args = createStringArray();
-	command->name = command->input = command->output = NULL;
-	command->rewriteOutput = 0;
+	struct Command* command = allocateFromArena(arena, sizeof(struct Command));
+	memset(command, 0, sizeof(struct Command));
+	command->arena = arena;
 	return command;
 }
 
-void freeCommand(struct Command* command)
+static void addView(struct Arena* arena, struct StringView** views, int* size, int* capacity, struct StringView view)
 {
-	if (!command)
-		return;
+	if (*size == *capacity)
+	{
+		int newSize = min(max((int)(*capacity * ARRAY_GROWTH_FACTOR), MIN_ARRAY_SIZE), *capacity + MAX_ARRAY_GROW_SIZE);
+		*views = reallocateFromArena(arena, *views, (size_t)*capacity * sizeof(struct StringView), (size_t)newSize * sizeof(struct StringView));
+		*capacity = newSize;
+	}
+
+	(*views)[*size] = view;
+	(*size)++;
+}
+
+void addArgument(struct Command* command, struct StringView arg)
+{
+	addView(command->arena, &command->args, &command->nArgs, &command->argsCapacity, arg);
+}
 
-	free(command->name);
-	free(command->input);
-	free(command->output);
-	freeStringArray(command->args);
-	free(command);
+void addAssignment(struct Command* command, struct StringView assignment)
+{
+	addView(command->arena, &command->assignments, &command->nAssignments, &command->assignmentsCapacity, assignment);
 }
 
 void addCommand(struct Job* job, struct Command* command)
@@ -35,13 +48,7 @@ void addCommand(struct Job* job, struct Command* command)
 	if (job->size == job->capacity)
 	{
 		int newSize = min(max((int)(job->capacity * ARRAY_GROWTH_FACTOR), MIN_ARRAY_SIZE), job->capacity + MAX_ARRAY_GROW_SIZE);
-		job->commands = realloc(job->commands, (size_t)newSize * sizeof(struct Command*));
-		if (!job->commands)
-		{
-			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
-			exit(1);
-		}
-
+		job->commands = reallocateFromArena(job->arena, job->commands, (size_t)job->capacity * sizeof(struct Command*), (size_t)newSize * sizeof(struct Command*));
 		job->capacity = newSize;
 	}
 
@@ -49,11 +56,14 @@ void addCommand(struct Job* job, struct Command* command)
 	job->size++;
 }
 
-struct Job* createJob()
+struct Job* createJob(struct Arena* arena)
 {
-	struct Job* job = malloc(sizeof(struct Job));
+	struct Job* job = allocateFromArena(arena, sizeof(struct Job));
 	job->commands = NULL;
 	job->size = job->capacity = 0;
+	job->background = 0;
+	job->timed = 0;
+	job->arena = arena;
 	return job;
 }
 
@@ -62,13 +72,7 @@ void addJob(struct Jobs* jobs, struct Job* job)
 	if (jobs->size == jobs->capacity)
 	{
 		int newSize = min(max((int)(jobs->capacity * ARRAY_GROWTH_FACTOR), MIN_ARRAY_SIZE), jobs->capacity + MAX_ARRAY_GROW_SIZE);
-		jobs->jobs = realloc(jobs->jobs, (size_t)newSize * sizeof(struct Job*));
-		if (!jobs->jobs)
-		{
-			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
-			exit(1);
-		}
-
+		jobs->jobs = reallocateFromArena(jobs->arena, jobs->jobs, (size_t)jobs->capacity * sizeof(struct Job*), (size_t)newSize * sizeof(struct Job*));
 		jobs->capacity = newSize;
 	}
 
@@ -76,39 +80,104 @@ void addJob(struct Jobs* jobs, struct Job* job)
 	jobs->size++;
 }
 
-void freeJob(struct Job* job)
+static void addWord(struct String* s, const char* word, int size)
 {
-	if (!job)
+	if (s->size > 0)
+		addSymbol(s, ' ');
+
+	if (size > 1 && word[0] == SUBSTITUTION_MARK)
+	{
+		addSymbol(s, word[1]);
+		addSymbol(s, '(');
+		addSymbols(s, word + 2, size - 2);
+		addSymbol(s, ')');
 		return;
+	}
 
-	for (int i = 0; i < job->size; ++i)
-		freeCommand(job->commands[i]);
+	for (int i = 0; i < size; ++i)
+	{
+		if (word[i] != GLOB_MARK)
+			addSymbol(s, word[i] == EXPANSION_MARK ? '$' : word[i]);
+	}
+}
 
-	free(job->commands);
-	free(job);
+static void addViewWord(struct String* s, struct StringView word)
+{
+	addWord(s, word.data, word.size);
 }
 
-struct Jobs* createJobs()
+static void addCommandWords(struct String* s, const struct Command* command)
 {
-	struct Jobs* jobs = malloc(sizeof(struct Jobs));
-	jobs->jobs = NULL;
-	jobs->size = jobs->capacity = 0;
-	return jobs;
+	for (int j = 0; j < command->nAssignments; ++j)
+		addViewWord(s, command->assignments[j]);
+
+	if (command->name.data)
+		addViewWord(s, command->name);
+
+	if (command->body.data)
+	{
+		addSymbols(s, "() {", 4);
+		addSymbols(s, command->body.data, command->body.size);
+		addSymbol(s, '}');
+	}
+
+	for (int j = 0; j < command->nArgs; ++j)
+		addViewWord(s, command->args[j]);
+
+	if (command->input.data && command->inputType == INPUT_HERE_DOCUMENT)
+	{
+		/* body may be large, it is not shown */
+		addWord(s, "<<here-document", 15);
+	}
+	else if (command->input.data)
+	{
+		addWord(s, command->inputType == INPUT_HERE_STRING ? "<<<" : "<", command->inputType == INPUT_HERE_STRING ? 3 : 1);
+		addViewWord(s, command->input);
+	}
+
+	if (command->output.data)
+	{
+		addWord(s, command->rewriteOutput ? ">" : ">>", command->rewriteOutput ? 1 : 2);
+		addViewWord(s, command->output);
+	}
 }
 
-void freeJobs(struct Jobs* jobs)
+char* commandToString(const struct Command* command)
 {
-	if (!jobs)
-		return;
+	struct String* s = createString();
+	addCommandWords(s, command);
 
-	for (int i = 0; i < jobs->size; ++i)
-		freeJob(jobs->jobs[i]);
+	char* ret = duplicateString(s->data);
+	freeString(s);
+	return ret;
+}
+
+char* jobToString(const struct Job* job)
+{
+	struct String* s = createString();
+	if (job->timed)
+		addWord(s, "time", 4);
 
-	free(jobs->jobs);
+	for (int i = 0; i < job->size; ++i)
+	{
+		if (i > 0)
+			addWord(s, "|", 1);
+
+		addCommandWords(s, job->commands[i]);
+	}
+
+	char* ret = duplicateString(s->data);
+	freeString(s);
+	return ret;
+}
+
+struct Jobs* createJobs(struct Arena* arena)
+{
+	struct Jobs* jobs = allocateFromArena(arena, sizeof(struct Jobs));
 	jobs->jobs = NULL;
 	jobs->size = jobs->capacity = 0;
-
-	free(jobs);
+	jobs->arena = arena;
+	return jobs;
 }
 
 void printJobs(const struct Jobs* jobs)
@@ -123,15 +192,13 @@ void printJobs(const struct Jobs* jobs)
 		for (int j = 0; j < nCommands; ++j)
 		{
 			struct Command* command = job->commands[j];
-			printf("  cmd: %s\n", command->name);
+			printf("  cmd: %.*s\n", command->name.size, command->name.data);
 			printf("  args:\n");
-			struct StringArray* args = command->args;
-			int nArgs = args->size;
-			for (int k = 0; k < nArgs; ++k)
-				printf("    %s\n", args->data[k]);
+			for (int k = 0; k < command->nArgs; ++k)
+				printf("    %.*s\n", command->args[k].size, command->args[k].data);
 
-			printf("  input: %s\n", command->input ? command->input : "none");
-			printf("  output: %s\n", command->output ? command->output : "none");
+			printf("  input: %.*s\n", command->input.data ? command->input.size : 4, command->input.data ? command->input.data : "none");
+			printf("  output: %.*s\n", command->output.data ? command->output.size : 4, command->output.data ? command->output.data : "none");
 			printf("  overwrite: %d\n\n", command->rewriteOutput);
 		}
 	}
@@ -1,14 +1,43 @@
 #ifndef JOB_H
 #define JOB_H
 
+#include "utils.h"
+
+/* Parse tree of a command line. All nodes are allocated from the arena
+ * they were created with and are released together with it. */
+
+/* what input of a command is */
+#define INPUT_FILE 0
+#define INPUT_HERE_DOCUMENT 1 /* text of the lines after the command */
+#define INPUT_HERE_STRING 2   /* word after "<<<", a new line is added to it */
+
+/* First symbol of a "<(list)" or ">(list)" word, which is followed by '<' or '>'
+ * and the text of the list. The executor replaces the word with "/dev/fd/N". */
+#define SUBSTITUTION_MARK '\003'
+
+/* Words are views into the parsed text (or into the arena if they had to be
+ * rewritten), missing input/output has NULL data. */
 struct Command
 {
-	char* name;
-	struct StringArray* args;
+	struct StringView name;
+	struct StringView* args;
+	int nArgs;
+	int argsCapacity;
+
+	/* "NAME=value" words before the name */
+	struct StringView* assignments;
+	int nAssignments;
+	int assignmentsCapacity;
 
-	char* input;
-	char* output;
+	struct StringView input;
+	int inputType;
+	struct StringView output;
 	int rewriteOutput;
+
+	/* text between braces of "name() { body }", the command only defines the function */
+	struct StringView body;
+
+	struct Arena* arena;
 };
 
 struct Job
@@ -16,6 +45,10 @@ struct Job
 	struct Command** commands;
 	int size;
 	int capacity;
+	int background;
+	int timed; /* "time" before the pipeline */
+
+	struct Arena* arena;
 };
 
 struct Jobs
@@ -23,18 +56,21 @@ struct Jobs
 	struct Job** jobs;
 	int size;
 	int capacity;
+
+	struct Arena* arena;
 };
 
-struct Command* createCommand();
-void freeCommand(struct Command* command);
+struct Command* createCommand(struct Arena* arena);
+void addArgument(struct Command* command, struct StringView arg);
+void addAssignment(struct Command* command, struct StringView assignment);
 void addCommand(struct Job* job, struct Command* command);
 
-struct Job* createJob();
+struct Job* createJob(struct Arena* arena);
 void addJob(struct Jobs* jobs, struct Job* job);
-void freeJob(struct Job* job);
+char* commandToString(const struct Command* command);
+char* jobToString(const struct Job* job);
 
-struct Jobs* createJobs();
-void freeJobs(struct Jobs* jobs);
+struct Jobs* createJobs(struct Arena* arena);
 void printJobs(const struct Jobs* jobs);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "commands.h"
+#include "jobtable.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define MIN_ARRAY_SIZE 8
+
+struct BackgroundJob
+{
+	int id;
+	char* text;
+	struct Pipeline* pipeline;
+	pid_t* pids; /* pids of the pipeline are reset when processes exit, these stay for "wait pid" */
+};
+
+struct JobTable
+{
+	struct BackgroundJob* jobs;
+	int size;
+	int capacity;
+};
+
+static struct JobTable g_jobTable = { NULL, 0, 0 };
+
+int g_jobControl = 0;
+
+void initJobControl()
+{
+	if (!isatty(STDIN_FILENO))
+		return;
+
+	/* wait until shell is in foreground */
+	pid_t pgid;
+	while (tcgetpgrp(STDIN_FILENO) != (pgid = getpgrp()))
+		kill(-pgid, SIGTTIN);
+
+	signal(SIGTSTP, SIG_IGN);
+	signal(SIGTTIN, SIG_IGN);
+	signal(SIGTTOU, SIG_IGN);
+
+	/* put shell into its own process group */
+	setpgid(0, 0);
+	tcsetpgrp(STDIN_FILENO, getpgrp());
+
+	g_jobControl = 1;
+}
+
+void freeJobTable()
+{
+	for (int i = 0; i < g_jobTable.size; ++i)
+	{
+		free(g_jobTable.jobs[i].text);
+		free(g_jobTable.jobs[i].pids);
+		freePipeline(g_jobTable.jobs[i].pipeline);
+	}
+
+	free(g_jobTable.jobs);
+	memset(&g_jobTable, 0, sizeof(g_jobTable));
+}
+
+int addBackgroundJob(struct Pipeline* pipeline, const char* text)
+{
+	if (g_jobTable.size == g_jobTable.capacity)
+	{
+		int newCapacity = max(g_jobTable.capacity * 2, MIN_ARRAY_SIZE);
+		g_jobTable.jobs = realloc(g_jobTable.jobs, (size_t)newCapacity * sizeof(struct BackgroundJob));
+		if (!g_jobTable.jobs)
+		{
+			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+			exit(1);
+		}
+
+		g_jobTable.capacity = newCapacity;
+	}
+
+	/* numbers are reused once all later jobs are gone */
+	int id = g_jobTable.size ? g_jobTable.jobs[g_jobTable.size - 1].id + 1 : 1;
+
+	struct BackgroundJob* job = &g_jobTable.jobs[g_jobTable.size++];
+	job->id = id;
+	job->text = duplicateString(text);
+	job->pipeline = pipeline;
+	job->pids = malloc((size_t)max(pipeline->size, 1) * sizeof(pid_t));
+	if (!job->pids)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	memcpy(job->pids, pipeline->pids, (size_t)pipeline->size * sizeof(pid_t));
+	return id;
+}
+
+int getBackgroundJobsCount()
+{
+	return g_jobTable.size;
+}
+
+static void removeBackgroundJob(int index)
+{
+	free(g_jobTable.jobs[index].text);
+	free(g_jobTable.jobs[index].pids);
+	freePipeline(g_jobTable.jobs[index].pipeline);
+
+	memmove(g_jobTable.jobs + index, g_jobTable.jobs + index + 1, (size_t)(g_jobTable.size - index - 1) * sizeof(struct BackgroundJob));
+	g_jobTable.size--;
+}
+
+static const char* getJobState(const struct Pipeline* pipeline)
+{
+	if (!pipeline->nRunning)
+		return "Done";
+
+	return pipeline->nStopped ? "Stopped" : "Running";
+}
+
+static void printBackgroundJob(const struct BackgroundJob* job)
+{
+	printf("[%d]  %-10s%s\n", job->id, getJobState(job->pipeline), job->text);
+}
+
+void waitForegroundPipeline(struct Pipeline* pipeline)
+{
+	if (g_jobControl && pipeline->pgid > 0)
+		tcsetpgrp(STDIN_FILENO, pipeline->pgid);
+
+	waitPipeline(pipeline);
+
+	if (g_jobControl)
+		tcsetpgrp(STDIN_FILENO, getpgrp());
+}
+
+void reportFinishedJobs(int print)
+{
+	sigset_t oldMask;
+	blockChildSignal(&oldMask);
+
+	for (int i = 0; i < g_jobTable.size;)
+	{
+		if (!g_jobTable.jobs[i].pipeline->nRunning)
+		{
+			if (print)
+				printBackgroundJob(&g_jobTable.jobs[i]);
+
+			removeBackgroundJob(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	restoreSignalMask(&oldMask);
+}
+
+/* accepts "%N", or bare number which is a pid if byPid is set and job number otherwise */
+static int findBackgroundJob(const char* spec, int byPid)
+{
+	if (!spec)
+		return g_jobTable.size - 1;
+
+	if (*spec == '%')
+	{
+		byPid = 0;
+		++spec;
+	}
+
+	char* end;
+	long value = strtol(spec, &end, 10);
+	if (*spec == '\0' || *end != '\0')
+		return -1;
+
+	for (int i = 0; i < g_jobTable.size; ++i)
+	{
+		const struct BackgroundJob* job = &g_jobTable.jobs[i];
+		if (!byPid)
+		{
+			if (job->id == value)
+				return i;
+
+			continue;
+		}
+
+		for (int j = 0; j < job->pipeline->size; ++j)
+		{
+			if (job->pids[j] == value)
+				return i;
+		}
+	}
+
+	return -1;
+}
+
+static int getJobArgument(const char* name, int argc, char** argv)
+{
+	int index = findBackgroundJob(argc > 1 ? argv[1] : NULL, 0);
+	if (index == -1)
+		fprintf(ERROR_OUTPUT, "%s: %s: no such job\n", name, argc > 1 ? argv[1] : "current");
+
+	return index;
+}
+
+int jobs(int argc, char** argv)
+{
+	/* a job finishing in between would be printed both as running and as done */
+	sigset_t oldMask;
+	blockChildSignal(&oldMask);
+
+	/* finished jobs are printed and removed by reportFinishedJobs */
+	for (int i = 0; i < g_jobTable.size; ++i)
+	{
+		if (g_jobTable.jobs[i].pipeline->nRunning)
+			printBackgroundJob(&g_jobTable.jobs[i]);
+	}
+
+	reportFinishedJobs(1);
+	restoreSignalMask(&oldMask);
+	return 0;
+}
+
+int fg(int argc, char** argv)
+{
+	int index = getJobArgument("fg", argc, argv);
+	if (index == -1)
+		return 1;
+
+	struct BackgroundJob* job = &g_jobTable.jobs[index];
+	struct Pipeline* pipeline = job->pipeline;
+	printf("%s\n", job->text);
+	fflush(stdout);
+
+	/* terminal has to be given away before the job continues */
+	if (g_jobControl && pipeline->pgid > 0)
+		tcsetpgrp(STDIN_FILENO, pipeline->pgid);
+
+	if (pipeline->nStopped)
+		continuePipeline(pipeline);
+
+	waitForegroundPipeline(pipeline);
+
+	if (pipeline->nStopped)
+	{
+		printf("\n");
+		printBackgroundJob(job);
+		return 128 + SIGTSTP;
+	}
+
+	int status = getPipelineStatus(pipeline, g_shellOptions.pipefail);
+	removeBackgroundJob(index);
+	return status;
+}
+
+int bg(int argc, char** argv)
+{
+	int index = getJobArgument("bg", argc, argv);
+	if (index == -1)
+		return 1;
+
+	struct BackgroundJob* job = &g_jobTable.jobs[index];
+	if (job->pipeline->nStopped)
+		continuePipeline(job->pipeline);
+
+	printf("[%d]  %s &\n", job->id, job->text);
+	return 0;
+}
+
+int waitJobs(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		/* wait for every running job */
+		for (int i = 0; i < g_jobTable.size; ++i)
+		{
+			if (!g_jobTable.jobs[i].pipeline->nStopped)
+				waitPipeline(g_jobTable.jobs[i].pipeline);
+		}
+
+		reportFinishedJobs(1);
+		return 0;
+	}
+
+	int ret = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		int index = findBackgroundJob(argv[i], 1);
+		if (index == -1)
+		{
+			fprintf(ERROR_OUTPUT, "wait: %s: no such job\n", argv[i]);
+			ret = 127;
+			continue;
+		}
+
+		struct Pipeline* pipeline = g_jobTable.jobs[index].pipeline;
+		waitPipeline(pipeline);
+
+		if (pipeline->nStopped)
+		{
+			ret = 128 + SIGTSTP;
+		}
+		else
+		{
+			ret = getPipelineStatus(pipeline, g_shellOptions.pipefail);
+			removeBackgroundJob(index);
+		}
+	}
+
+	return ret;
+}
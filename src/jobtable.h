@@ -0,0 +1,31 @@
+#ifndef JOBTABLE_H
+#define JOBTABLE_H
+
+#include "process.h"
+
+/* Jobs which run in background or were stopped, see "jobs" in bash. */
+
+extern int g_jobControl;
+
+/* Enables process groups and terminal control if the shell is interactive. */
+void initJobControl();
+void freeJobTable();
+
+/* Takes ownership of the pipeline. Returns job number. SIGCHLD has to be blocked
+ * since the pipeline was started, so the job can be found by pid of every its process. */
+int addBackgroundJob(struct Pipeline* pipeline, const char* text);
+int getBackgroundJobsCount();
+
+/* Gives terminal to the pipeline and waits until it finishes or stops. */
+void waitForegroundPipeline(struct Pipeline* pipeline);
+
+/* Forgets background jobs which have finished, printing them if print is set.
+ * Scripts do not call it, so "wait" still gets the status of a finished job. */
+void reportFinishedJobs(int print);
+
+int jobs(int argc, char** argv);
+int fg(int argc, char** argv);
+int bg(int argc, char** argv);
+int waitJobs(int argc, char** argv);
+
+#endif
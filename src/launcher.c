@@ -0,0 +1,321 @@
+#define _GNU_SOURCE
+
+#include "launcher.h"
+#include "utils.h"
+
+#include <signal.h>
+#include <spawn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+static void bindDescriptors(int infd, int outfd)
+{
+	if (infd != STDIN_FILENO)
+	{
+		close(STDIN_FILENO);
+		if (infd != -1)
+			dup2(infd, STDIN_FILENO);
+	}
+
+	if (outfd != STDOUT_FILENO)
+	{
+		close(STDOUT_FILENO);
+		if (outfd != -1)
+			dup2(outfd, STDOUT_FILENO);
+	}
+}
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define PIPE_MAX_SIZE_FILE "/proc/sys/fs/pipe-max-size"
+
+static int getPipeMaxSize()
+{
+	static int maxSize = -1;
+	if (maxSize != -1)
+		return maxSize;
+
+	maxSize = 0;
+	FILE* file = fopen(PIPE_MAX_SIZE_FILE, "re");
+	if (file)
+	{
+		if (fscanf(file, "%d", &maxSize) != 1)
+			maxSize = 0;
+
+		fclose(file);
+	}
+
+	return maxSize;
+}
+
+int createPipe(int pfd[2], int size)
+{
+	if (pipe2(pfd, O_CLOEXEC) == -1)
+		return -1;
+
+	if (size <= 0)
+		return 0;
+
+	/* warn only once for every requested size */
+	static int lastFailedSize = 0;
+
+	if (fcntl(pfd[1], F_SETPIPE_SZ, size) == -1)
+	{
+		int error = errno;
+		int maxSize = getPipeMaxSize();
+		int actualSize = maxSize > 0 && maxSize < size ? fcntl(pfd[1], F_SETPIPE_SZ, maxSize) : -1;
+
+		if (lastFailedSize != size)
+		{
+			if (actualSize != -1)
+				fprintf(ERROR_OUTPUT, "pipesize: %d exceeds %s, using %d\n", size, PIPE_MAX_SIZE_FILE, actualSize);
+			else
+				fprintf(ERROR_OUTPUT, "pipesize: cannot set pipe capacity to %d: %s\n", size, strerror(error));
+
+			lastFailedSize = size;
+		}
+	}
+
+	return 0;
+}
+
+int createInputDescriptor(const char* data, int size)
+{
+	/* text which fits into an empty pipe is written without blocking */
+	int pfd[2];
+	if (pipe2(pfd, O_CLOEXEC) != -1)
+	{
+		int capacity = fcntl(pfd[1], F_GETPIPE_SZ);
+		if (size <= capacity && !writeAll(pfd[1], data, size))
+		{
+			close(pfd[1]);
+			return pfd[0];
+		}
+
+		close(pfd[0]);
+		close(pfd[1]);
+	}
+
+	/* larger text goes into memory, it is sealed so readers see it unchanged */
+	int fd = memfd_create("here-document", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd == -1)
+		return -1;
+
+	if (writeAll(fd, data, size) == -1 || lseek(fd, 0, SEEK_SET) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+
+	fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+	return fd;
+}
+
+/* signals which shell handles or ignores itself */
+static void getShellSignals(sigset_t* signals)
+{
+	sigemptyset(signals);
+	sigaddset(signals, SIGINT);
+	sigaddset(signals, SIGQUIT);
+	sigaddset(signals, SIGCHLD);
+	sigaddset(signals, SIGTSTP);
+	sigaddset(signals, SIGTTIN);
+	sigaddset(signals, SIGTTOU);
+}
+
+#define SCRIPT_INTERPRETER "/bin/sh"
+
+/* file without "#!" line is run as a script of the system shell, like execvp does */
+static int spawnScript(pid_t* cpid, const char* path, const posix_spawn_file_actions_t* actions, const posix_spawnattr_t* attr, char* const* argv, char* const* envp)
+{
+	int argc = 0;
+	while (argv[argc])
+		++argc;
+
+	/* argv[0] is replaced with the interpreter and path, the null pointer is copied too */
+	char** args = malloc((size_t)(argc + 2) * sizeof(char*));
+	if (!args)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	args[0] = SCRIPT_INTERPRETER;
+	args[1] = (char*)path;
+	memcpy(args + 2, argv + 1, (size_t)argc * sizeof(char*));
+
+	int ret = posix_spawn(cpid, SCRIPT_INTERPRETER, actions, attr, args, envp);
+	free(args);
+	return ret;
+}
+
+pid_t spawnProcess(const char* path, char* const* argv, char* const* envp, int infd, int outfd, pid_t pgid, int* error)
+{
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+
+	/* all descriptors opened by shell are close-on-exec, dup2 clears the flag for std ones */
+	if (infd != STDIN_FILENO)
+	{
+		if (infd != -1)
+			posix_spawn_file_actions_adddup2(&actions, infd, STDIN_FILENO);
+		else
+			posix_spawn_file_actions_addclose(&actions, STDIN_FILENO);
+	}
+
+	if (outfd != STDOUT_FILENO)
+	{
+		if (outfd != -1)
+			posix_spawn_file_actions_adddup2(&actions, outfd, STDOUT_FILENO);
+		else
+			posix_spawn_file_actions_addclose(&actions, STDOUT_FILENO);
+	}
+
+	/* child starts with default signal handling and nothing blocked */
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+
+	short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+	sigset_t signals;
+	getShellSignals(&signals);
+	posix_spawnattr_setsigdefault(&attr, &signals);
+	sigemptyset(&signals);
+	posix_spawnattr_setsigmask(&attr, &signals);
+
+	if (pgid != PGID_NONE)
+	{
+		flags |= POSIX_SPAWN_SETPGROUP;
+		posix_spawnattr_setpgroup(&attr, pgid);
+	}
+
+	posix_spawnattr_setflags(&attr, flags);
+
+	pid_t cpid = -1;
+	int ret = posix_spawn(&cpid, path, &actions, &attr, argv, envp);
+	if (ret == ENOEXEC)
+		ret = spawnScript(&cpid, path, &actions, &attr, argv, envp);
+
+	posix_spawn_file_actions_destroy(&actions);
+	posix_spawnattr_destroy(&attr);
+
+	if (ret != 0)
+	{
+		*error = ret;
+		return -1;
+	}
+
+	/* set group from parent too, so it exists before the next stage joins it */
+	if (pgid != PGID_NONE)
+		setpgid(cpid, pgid == PGID_NEW ? cpid : pgid);
+
+	*error = 0;
+	return cpid;
+}
+
+pid_t forkProcess(int infd, int outfd, pid_t pgid)
+{
+	/* do not let the child flush a copy of pending shell output */
+	fflush(NULL);
+
+	pid_t cpid = fork();
+	if (!cpid)
+	{
+		if (pgid != PGID_NONE)
+			setpgid(0, pgid);
+
+		sigset_t signals;
+		getShellSignals(&signals);
+		for (int sig = 1; sig < NSIG; ++sig)
+		{
+			if (sigismember(&signals, sig) == 1)
+				signal(sig, SIG_DFL);
+		}
+
+		sigemptyset(&signals);
+		sigprocmask(SIG_SETMASK, &signals, NULL);
+
+		bindDescriptors(infd, outfd);
+	}
+	else if (cpid != -1 && pgid != PGID_NONE)
+	{
+		setpgid(cpid, pgid == PGID_NEW ? cpid : pgid);
+	}
+
+	return cpid;
+}
+
+void closeShellDescriptors(const int* keep, int nKeep)
+{
+	/* close ranges between kept descriptors, from the lowest one up */
+	unsigned int first = STDERR_FILENO + 1;
+	for (;;)
+	{
+		unsigned int next = ~0U;
+		for (int i = 0; i < nKeep; ++i)
+		{
+			if (keep[i] >= (int)first && (unsigned int)keep[i] < next)
+				next = (unsigned int)keep[i];
+		}
+
+		if (next > first && close_range(first, next - 1, 0) == -1)
+		{
+			/* kernel without close_range */
+			long last = next == ~0U ? sysconf(_SC_OPEN_MAX) : (long)next;
+			for (long fd = first; fd < last; ++fd)
+				close((int)fd);
+		}
+
+		if (next == ~0U)
+			break;
+
+		first = next + 1;
+	}
+}
+
+/* keep saved descriptors away from the ones children may use */
+#define MIN_SAVED_FD 10
+
+static int replaceDescriptor(int fd, int target)
+{
+	if (fd == target)
+		return -1;
+
+	int saved = fcntl(target, F_DUPFD_CLOEXEC, MIN_SAVED_FD);
+	if (fd != -1)
+		dup2(fd, target);
+	else
+		close(target);
+
+	return saved;
+}
+
+void redirectStdio(int infd, int outfd, int saved[2])
+{
+	fflush(stdout);
+
+	saved[0] = replaceDescriptor(infd, STDIN_FILENO);
+	saved[1] = replaceDescriptor(outfd, STDOUT_FILENO);
+}
+
+void restoreStdio(const int saved[2])
+{
+	fflush(stdout);
+
+	if (saved[0] != -1)
+	{
+		dup2(saved[0], STDIN_FILENO);
+		close(saved[0]);
+	}
+
+	if (saved[1] != -1)
+	{
+		dup2(saved[1], STDOUT_FILENO);
+		close(saved[1]);
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include <sys/types.h>
+
+/* pgid argument: keep process group of the shell */
+#define PGID_NONE -1
+/* pgid argument: start a new process group led by the child */
+#define PGID_NEW 0
+
+/* Starts program located at path with stdin/stdout bound to infd/outfd and given environment.
+ * The child is created with posix_spawn (vfork semantics), so the cost
+ * does not depend on the size of the shell process. A file which is not a binary
+ * and has no "#!" line is run with /bin/sh, like execvp does.
+ * Returns pid of the child or -1, in which case *error holds errno. */
+pid_t spawnProcess(const char* path, char* const* argv, char* const* envp, int infd, int outfd, pid_t pgid, int* error);
+
+/* Forks a child which has to run shell code (e.g. a builtin inside a pipeline).
+ * Returns 0 in the child with stdin/stdout already bound to infd/outfd. */
+pid_t forkProcess(int infd, int outfd, pid_t pgid);
+
+/* Called in a forked child: closes all descriptors above stderr except keep, so pipe ends
+ * and files the shell holds for other stages do not stay open while the child runs. */
+void closeShellDescriptors(const int* keep, int nKeep);
+
+/* Creates close-on-exec pipe with capacity of at least size bytes (0 keeps default).
+ * Capacity above /proc/sys/fs/pipe-max-size falls back to the maximum with a warning. */
+int createPipe(int pfd[2], int size);
+
+/* Returns close-on-exec descriptor to read the data from. Data which fits into a pipe
+ * is written into one, larger data goes into a sealed memfd file. Returns -1 on failure. */
+int createInputDescriptor(const char* data, int size);
+
+/* Binds stdin/stdout of the shell itself to infd/outfd, so builtins
+ * can run without fork. Previous descriptors are kept in saved. */
+void redirectStdio(int infd, int outfd, int saved[2]);
+void restoreStdio(const int saved[2]);
+
+#endif
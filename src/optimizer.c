@@ -0,0 +1,114 @@
+#include "commands.h"
+#include "functions.h"
+#include "glob.h"
+#include "optimizer.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int isRewrittenCommand(const char* name)
+{
+	return !strcmp(name, "cat");
+}
+
+static int isCat(const struct Command* command)
+{
+	return isViewEqual(command->name, "cat") && command->nAssignments == 0 && !command->body.data && !findFunction("cat");
+}
+
+/* "cat" or "cat < file", copies input to output unchanged */
+static int isPlainCat(const struct Command* command)
+{
+	return isCat(command) && command->nArgs == 0;
+}
+
+/* "cat file" */
+static int isFileCat(const struct Command* command)
+{
+	const struct StringView* arg = command->nArgs == 1 ? &command->args[0] : NULL;
+	return isCat(command) && !command->input.data && arg && arg->size > 0 && arg->data[0] != '-'
+		&& !memchr(arg->data, GLOB_MARK, (size_t)arg->size);
+}
+
+static void removeCommand(struct Job* job, int index)
+{
+	/* memory of the command is released with the arena */
+	memmove(job->commands + index, job->commands + index + 1, (size_t)(job->size - index - 1) * sizeof(struct Command*));
+	job->size--;
+}
+
+static void moveView(struct StringView* dst, struct StringView* src)
+{
+	*dst = *src;
+	src->data = NULL;
+	src->size = 0;
+}
+
+int optimizeJob(struct Job* job)
+{
+	int nRemoved = 0;
+	int i = 0;
+	while (job->size > 1 && i < job->size)
+	{
+		struct Command* command = job->commands[i];
+		struct Command* prev = i > 0 ? job->commands[i - 1] : NULL;
+		struct Command* next = i < job->size - 1 ? job->commands[i + 1] : NULL;
+
+		/* output of a stage with redirected output does not go into the pipe */
+		if (!prev && next && !command->output.data && !next->input.data && (isFileCat(command) || (isPlainCat(command) && command->input.data)))
+		{
+			/* "cat file | cmd" or "cat < file | cmd" */
+			if (isFileCat(command))
+			{
+				moveView(&next->input, &command->args[0]);
+				command->nArgs = 0;
+			}
+			else
+			{
+				moveView(&next->input, &command->input);
+				next->inputType = command->inputType;
+			}
+		}
+		else if (prev && !next && isPlainCat(command) && !command->input.data && command->output.data && !prev->output.data)
+		{
+			/* "cmd | cat > out", stdout is not a terminal in both cases */
+			moveView(&prev->output, &command->output);
+			prev->rewriteOutput = command->rewriteOutput;
+		}
+		else if (prev && next && isPlainCat(command) && !command->input.data && !command->output.data && !prev->output.data && !next->input.data)
+		{
+			/* "a | cat | b" */
+		}
+		else
+		{
+			++i;
+			continue;
+		}
+
+		removeCommand(job, i);
+		++nRemoved;
+	}
+
+	return nRemoved;
+}
+
+int optimizeJobs(struct Jobs* jobs)
+{
+	int nRemoved = 0;
+	for (int i = 0; i < jobs->size && g_shellOptions.optimize; ++i)
+		nRemoved += optimizeJob(jobs->jobs[i]);
+
+	return nRemoved;
+}
+
+void printPlan(const struct Jobs* jobs)
+{
+	for (int i = 0; i < jobs->size && g_shellOptions.showplan; ++i)
+	{
+		char* text = jobToString(jobs->jobs[i]);
+		fprintf(stderr, "plan: %s%s\n", text, jobs->jobs[i]->background ? " &" : "");
+		free(text);
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "job.h"
+
+/* Rewrites pipelines so they start fewer processes:
+ *   cat file | cmd      ->  cmd < file
+ *   cmd | cat > out     ->  cmd > out
+ *   a | cat | b         ->  a | b
+ * Returns number of removed stages. */
+int optimizeJob(struct Job* job);
+
+/* Returns 1 if rewritten trees depend on whether the command is a function. */
+int isRewrittenCommand(const char* name);
+
+/* Optimizes jobs if "optimize" option is set. */
+int optimizeJobs(struct Jobs* jobs);
+
+/* Prints jobs the way they are going to run if "showplan" option is set. */
+void printPlan(const struct Jobs* jobs);
+
+#endif
@@ -0,0 +1,295 @@
+#define _GNU_SOURCE
+
+#include "executor.h"
+#include "optimizer.h"
+#include "parallel.h"
+#include "parsecache.h"
+#include "process.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+extern int g_exitShell;
+
+#define READ_BLOCK_SIZE 65536
+
+/* last SIGINT or SIGTERM received while tasks run (0 if none) and number of them */
+static volatile sig_atomic_t g_interruptSignal = 0;
+static volatile sig_atomic_t g_nInterrupts = 0;
+
+struct Slot
+{
+	struct ParsedLine* line;
+	const struct Jobs* jobs;
+	int currentJob;
+	struct Pipeline* pipeline;
+	int fd;
+	struct String* output;
+	int status;
+};
+
+static double getSeconds(const struct timeval* tv)
+{
+	return (double)tv->tv_sec + (double)tv->tv_usec / 1e6;
+}
+
+static void interruptHandler(int sig)
+{
+	g_interruptSignal = sig;
+	g_nInterrupts++;
+}
+
+/* starts next job of the slot, returns 0 if there is nothing left to start */
+static int startSlotJob(struct Slot* slot, int devNull)
+{
+	if (g_interruptSignal || !slot->jobs || slot->currentJob >= slot->jobs->size)
+		return 0;
+
+	int pfd[2];
+	if (pipe2(pfd, O_CLOEXEC) == -1)
+	{
+		fprintf(ERROR_OUTPUT, "parallel: %s\n", strerror(errno));
+		return 0;
+	}
+
+	slot->pipeline = startJob(slot->jobs->jobs[slot->currentJob], devNull, pfd[1], 1);
+	slot->fd = pfd[0];
+	close(pfd[1]);
+	return 1;
+}
+
+static void releaseSlot(struct Slot* slot)
+{
+	if (slot->line)
+		releaseParsedLine(slot->line);
+
+	slot->line = NULL;
+	slot->jobs = NULL;
+}
+
+static int startSlot(struct Slot* slot, const char* text, int devNull)
+{
+	slot->line = acquireParsedLine(text);
+	slot->jobs = slot->line ? slot->line->jobs : NULL;
+	if (slot->jobs)
+		printPlan(slot->jobs);
+
+	slot->currentJob = 0;
+	slot->pipeline = NULL;
+	slot->fd = -1;
+	slot->status = slot->jobs ? 0 : 1;
+	emptyString(slot->output);
+
+	return startSlotJob(slot, devNull);
+}
+
+/* called when output of the current job is closed and all its processes have exited */
+static int finishSlotJob(struct Slot* slot, int devNull)
+{
+	slot->status = getPipelineStatus(slot->pipeline, 0);
+	freePipeline(slot->pipeline);
+	slot->pipeline = NULL;
+
+	slot->currentJob++;
+	if (startSlotJob(slot, devNull))
+		return 1;
+
+	writeAll(STDOUT_FILENO, slot->output->data, slot->output->size);
+	releaseSlot(slot);
+	return 0;
+}
+
+int parallel(int argc, char** argv)
+{
+	int nSlots = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int firstTask = 1;
+	if (argc > 1 && !strncmp(argv[1], "-j", 2))
+	{
+		const char* value = argv[1][2] ? argv[1] + 2 : (argc > 2 ? argv[2] : "");
+		firstTask = argv[1][2] ? 2 : 3;
+		nSlots = atoi(value);
+		if (nSlots < 1)
+		{
+			fprintf(ERROR_OUTPUT, "parallel: invalid number of slots: \"%s\"\n", value);
+			return 1;
+		}
+	}
+
+	nSlots = max(1, min(nSlots, argc - firstTask));
+	if (firstTask >= argc)
+		return 0;
+
+	struct timespec startTime, endTime;
+	struct rusage startUsage, endUsage;
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	getrusage(RUSAGE_CHILDREN, &startUsage);
+
+	/* own output goes straight to the descriptor, so flush what is pending */
+	fflush(stdout);
+
+	int devNull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+	/* tasks run in their own process groups, so "ctrl + c" reaches only the shell and is passed on;
+	 * the signals are delivered only while waiting, so a task cannot be started after one */
+	struct sigaction action, oldIntAction, oldTermAction;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = interruptHandler;
+	sigemptyset(&action.sa_mask);
+	g_interruptSignal = 0;
+	g_nInterrupts = 0;
+	sigaction(SIGINT, &action, &oldIntAction);
+	sigaction(SIGTERM, &action, &oldTermAction);
+
+	sigset_t oldMask;
+	blockChildSignal(&oldMask);
+	sigset_t interruptMask;
+	sigemptyset(&interruptMask);
+	sigaddset(&interruptMask, SIGINT);
+	sigaddset(&interruptMask, SIGTERM);
+	sigprocmask(SIG_BLOCK, &interruptMask, NULL);
+
+	sigset_t waitMask = oldMask;
+	sigdelset(&waitMask, SIGCHLD);
+	sigdelset(&waitMask, SIGINT);
+	sigdelset(&waitMask, SIGTERM);
+
+	struct Slot* slots = malloc((size_t)nSlots * sizeof(struct Slot));
+	struct pollfd* fds = malloc((size_t)nSlots * sizeof(struct pollfd));
+	int* fdSlots = malloc((size_t)nSlots * sizeof(int));
+	char* block = malloc(READ_BLOCK_SIZE);
+	for (int i = 0; i < nSlots; ++i)
+	{
+		slots[i].line = NULL;
+		slots[i].jobs = NULL;
+		slots[i].output = createString();
+	}
+
+	int nextTask = firstTask;
+	int nActive = 0;
+	int nFailed = 0;
+	int nForwarded = 0;
+	while (!g_exitShell && ((nextTask < argc && !g_interruptSignal) || nActive > 0))
+	{
+		/* fill free slots */
+		for (int i = 0; i < nSlots && nextTask < argc && !g_interruptSignal; ++i)
+		{
+			if (slots[i].jobs)
+				continue;
+
+			if (startSlot(&slots[i], argv[nextTask++], devNull))
+			{
+				++nActive;
+			}
+			else
+			{
+				nFailed += slots[i].status != 0;
+				releaseSlot(&slots[i]);
+			}
+		}
+
+		int nfds = 0;
+		for (int i = 0; i < nSlots; ++i)
+		{
+			if (slots[i].jobs && slots[i].fd != -1)
+			{
+				fds[nfds].fd = slots[i].fd;
+				fds[nfds].events = POLLIN;
+				fdSlots[nfds++] = i;
+			}
+		}
+
+		/* SIGCHLD interrupts waiting, so exited processes are noticed too */
+		int ready = ppoll(fds, (nfds_t)nfds, NULL, &waitMask);
+		if (g_nInterrupts != nForwarded)
+		{
+			/* every signal is passed on, so a task ignoring the first one can still be stopped;
+			 * output read so far is printed, next tasks are not started */
+			for (int i = 0; i < nSlots; ++i)
+			{
+				if (slots[i].jobs && slots[i].pipeline)
+					signalPipeline(slots[i].pipeline, g_interruptSignal);
+			}
+
+			nForwarded = g_nInterrupts;
+		}
+		for (int i = 0; ready > 0 && i < nfds; ++i)
+		{
+			if (!fds[i].revents)
+				continue;
+
+			struct Slot* slot = &slots[fdSlots[i]];
+			ssize_t nRead = read(slot->fd, block, READ_BLOCK_SIZE);
+			if (nRead > 0)
+			{
+				addSymbols(slot->output, block, (int)nRead);
+			}
+			else if (nRead == 0 || errno != EINTR)
+			{
+				close(slot->fd);
+				slot->fd = -1;
+			}
+		}
+
+		for (int i = 0; i < nSlots; ++i)
+		{
+			struct Slot* slot = &slots[i];
+			if (!slot->jobs || slot->fd != -1 || slot->pipeline->nRunning > 0)
+				continue;
+
+			if (!finishSlotJob(slot, devNull))
+			{
+				nFailed += slot->status != 0;
+				--nActive;
+			}
+		}
+	}
+
+	for (int i = 0; i < nSlots; ++i)
+	{
+		if (slots[i].jobs)
+		{
+			if (slots[i].fd != -1)
+				close(slots[i].fd);
+
+			freePipeline(slots[i].pipeline);
+		}
+
+		releaseSlot(&slots[i]);
+		freeString(slots[i].output);
+	}
+
+	free(block);
+	free(fdSlots);
+	free(fds);
+	free(slots);
+	close(devNull);
+
+	restoreSignalMask(&oldMask);
+	sigaction(SIGINT, &oldIntAction, NULL);
+	sigaction(SIGTERM, &oldTermAction, NULL);
+
+	/* the shell handles the signal the way it would without parallel, e.g. exits on SIGTERM */
+	if (g_interruptSignal)
+		raise(g_interruptSignal);
+
+	clock_gettime(CLOCK_MONOTONIC, &endTime);
+	getrusage(RUSAGE_CHILDREN, &endUsage);
+
+	double real = (double)(endTime.tv_sec - startTime.tv_sec) + (double)(endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+	fprintf(ERROR_OUTPUT, "parallel: %d jobs, %d failed, %d slots, real %.3fs, user %.3fs, sys %.3fs\n",
+		argc - firstTask, nFailed, nSlots, real,
+		getSeconds(&endUsage.ru_utime) - getSeconds(&startUsage.ru_utime),
+		getSeconds(&endUsage.ru_stime) - getSeconds(&startUsage.ru_stime));
+
+	return g_interruptSignal ? 128 + g_interruptSignal : min(nFailed, 255);
+}
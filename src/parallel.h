@@ -0,0 +1,9 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/* parallel [-j N] "command line"...
+ * Runs independent command lines in N slots (number of online CPUs by default).
+ * Output of every command line is collected and printed at once when it finishes. */
+int parallel(int argc, char** argv);
+
+#endif
@@ -0,0 +1,211 @@
+#include "aliases.h"
+#include "commands.h"
+#include "functions.h"
+#include "optimizer.h"
+#include "parsecache.h"
+#include "parser.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define PARSE_CACHE_SIZE 64
+#define MAX_FREE_ARENAS 8
+
+/* lines by text, entries are owned by the list below */
+static struct HashTable* g_parseCache = NULL;
+
+/* most recently used line first */
+static struct ParsedLine* g_firstLine = NULL;
+static struct ParsedLine* g_lastLine = NULL;
+
+static int g_cacheHits = 0;
+static int g_cacheMisses = 0;
+
+/* arenas of dropped lines, emptied and reused by the next misses */
+static struct Arena* g_freeArenas[MAX_FREE_ARENAS];
+static int g_nFreeArenas = 0;
+
+static struct Arena* takeArena()
+{
+	return g_nFreeArenas > 0 ? g_freeArenas[--g_nFreeArenas] : createArena();
+}
+
+static void freeParsedLine(struct ParsedLine* line)
+{
+	if (g_nFreeArenas < MAX_FREE_ARENAS)
+	{
+		emptyArena(line->arena);
+		g_freeArenas[g_nFreeArenas++] = line->arena;
+	}
+	else
+	{
+		freeArena(line->arena);
+	}
+
+	free(line);
+}
+
+static void unlinkParsedLine(struct ParsedLine* line)
+{
+	if (line->prev)
+		line->prev->next = line->next;
+	else
+		g_firstLine = line->next;
+
+	if (line->next)
+		line->next->prev = line->prev;
+	else
+		g_lastLine = line->prev;
+
+	line->prev = line->next = NULL;
+}
+
+static void linkParsedLine(struct ParsedLine* line)
+{
+	line->prev = NULL;
+	line->next = g_firstLine;
+	if (g_firstLine)
+		g_firstLine->prev = line;
+	else
+		g_lastLine = line;
+
+	g_firstLine = line;
+}
+
+/* lines which are running right now are freed when they finish */
+static void dropParsedLine(struct ParsedLine* line)
+{
+	removeHashTableValue(g_parseCache, line->text);
+	unlinkParsedLine(line);
+
+	if (line->users)
+		line->detached = 1;
+	else
+		freeParsedLine(line);
+}
+
+void initParseCache()
+{
+	g_parseCache = createHashTable(NULL);
+}
+
+void freeParseCache()
+{
+	clearParseCache();
+	freeHashTable(g_parseCache);
+	g_parseCache = NULL;
+
+	while (g_nFreeArenas > 0)
+		freeArena(g_freeArenas[--g_nFreeArenas]);
+}
+
+void clearParseCache()
+{
+	while (g_firstLine)
+		dropParsedLine(g_firstLine);
+}
+
+static struct ParsedLine* parseLine(const char* text)
+{
+	struct ParsedLine* line = malloc(sizeof(struct ParsedLine));
+	if (!line)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	/* words of the tree point into the text, so it has to live as long as the tree */
+	line->arena = takeArena();
+	line->text = duplicateArenaString(line->arena, text);
+
+	struct Jobs* jobs = parseProgramm(line->text, line->arena);
+	if (!jobs)
+	{
+		freeParsedLine(line);
+		return NULL;
+	}
+
+	optimizeJobs(jobs);
+
+	line->jobs = jobs;
+	line->optimized = g_shellOptions.optimize;
+	line->aliases = getAliasesVersion();
+	line->functions = getFunctionsVersion();
+	line->users = 0;
+	line->detached = 0;
+	line->prev = line->next = NULL;
+	return line;
+}
+
+int isParsedLineCurrent(const struct ParsedLine* line)
+{
+	return line->optimized == g_shellOptions.optimize && line->functions == getFunctionsVersion();
+}
+
+struct ParsedLine* acquireParsedLine(const char* text)
+{
+	struct ParsedLine* line = getHashTableValue(g_parseCache, text);
+	if (line && (!isParsedLineCurrent(line) || line->aliases != getAliasesVersion()))
+	{
+		/* tree was built for the other value of "optimize", with other aliases or functions */
+		dropParsedLine(line);
+		line = NULL;
+	}
+
+	if (line)
+	{
+		g_cacheHits++;
+		unlinkParsedLine(line);
+	}
+	else
+	{
+		g_cacheMisses++;
+		line = parseLine(text);
+		if (!line)
+			return NULL;
+
+		if (g_parseCache->size == PARSE_CACHE_SIZE)
+			dropParsedLine(g_lastLine);
+
+		setHashTableValue(g_parseCache, text, line);
+	}
+
+	linkParsedLine(line);
+	line->users++;
+	return line;
+}
+
+void releaseParsedLine(struct ParsedLine* line)
+{
+	line->users--;
+	if (!line->users && line->detached)
+		freeParsedLine(line);
+}
+
+void retainParsedLine(struct ParsedLine* line)
+{
+	line->users++;
+}
+
+int parsecache(int argc, char** argv)
+{
+	if (argc > 1 && !strcmp(argv[1], "-r"))
+	{
+		clearParseCache();
+		g_cacheHits = g_cacheMisses = 0;
+		return 0;
+	}
+	else if (argc > 1)
+	{
+		fprintf(ERROR_OUTPUT, "parsecache: %s: invalid option\n", argv[1]);
+		return 2;
+	}
+
+	printf("hits\tmisses\tlines\n");
+	printf("%d\t%d\t%d\n", g_cacheHits, g_cacheMisses, g_parseCache ? g_parseCache->size : 0);
+	return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef PARSECACHE_H
+#define PARSECACHE_H
+
+#include "job.h"
+
+/* Parse trees of recently run lines, so loops, scripts and lines recalled
+ * from history are parsed only once. Least recently used lines are dropped
+ * when the cache is full, their arenas are emptied and reused for new lines. */
+
+struct ParsedLine
+{
+	const struct Jobs* jobs;
+
+	/* private */
+	const char* text;
+	struct Arena* arena; /* copy of the text and the tree */
+	int optimized;       /* "optimize" option the tree was built with */
+	int aliases;         /* version of aliases the text was expanded with */
+	int functions;       /* version of functions the tree was optimized with */
+	int users;
+	int detached;        /* no longer in the cache, freed by the last user */
+	struct ParsedLine* prev;
+	struct ParsedLine* next;
+};
+
+void initParseCache();
+void freeParseCache();
+
+/* Returns parsed and optimized line, NULL on syntax error.
+ * The tree must not be changed and stays valid until releaseParsedLine. */
+struct ParsedLine* acquireParsedLine(const char* text);
+void releaseParsedLine(struct ParsedLine* line);
+/* Returns 0 if the tree was optimized with other value of "optimize" or other functions. */
+int isParsedLineCurrent(const struct ParsedLine* line);
+/* Keeps the line valid until one more releaseParsedLine. */
+void retainParsedLine(struct ParsedLine* line);
+
+void clearParseCache();
+
+/* parsecache [-r]
+ * Prints number of cache hits and misses, -r drops all lines and resets counters. */
+int parsecache(int argc, char** argv);
+
+#endif
@@ -0,0 +1,905 @@
+#include "aliases.h"
+#include "expand.h"
+#include "glob.h"
+#include "job.h"
+#include "parser.h"
+#include "trace.h"
+#include "utils.h"
+#include "variables.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define PARSING_STATE_COMMAND_NAME 0
+#define PARSING_STATE_COMMAND_ARGS 1
+#define PARSING_STATE_COMMAND_INPUT 2
+#define PARSING_STATE_COMMAND_OUTPUT 3
+
+/* aliases which expand to other aliases */
+#define MAX_ALIAS_DEPTH 16
+
+/* Token is kept as a slice of the parsed text. It is copied only when
+ * quotes or escapes are dropped from the middle of it or a symbol is replaced. */
+struct Token
+{
+	const char* start;
+	int size;
+	int copied;
+	struct String* copy;
+	int noAlias; /* quoted or already expanded */
+};
+
+/* text of an alias being parsed instead of the line */
+struct AliasFrame
+{
+	const char* alias;
+	const char* text;   /* start of the text parsed before the alias */
+	const char* resume; /* symbol after the alias name */
+};
+
+static void copyToken(struct Token* token)
+{
+	emptyString(token->copy);
+	addSymbols(token->copy, token->start, token->size);
+	token->copied = 1;
+}
+
+/* adds symbol of the parsed text */
+static void addTokenSymbol(struct Token* token, const char* symbol)
+{
+	if (!token->copied)
+	{
+		if (token->size == 0)
+			token->start = symbol;
+
+		if (token->start + token->size == symbol)
+		{
+			token->size++;
+			return;
+		}
+
+		copyToken(token);
+	}
+
+	addSymbol(token->copy, *symbol);
+	token->size++;
+}
+
+/* adds symbol which is not present in the parsed text */
+static void addTokenReplacement(struct Token* token, char symbol)
+{
+	if (!token->copied)
+		copyToken(token);
+
+	addSymbol(token->copy, symbol);
+	token->size++;
+}
+
+static struct StringView takeToken(struct Token* token, struct Arena* arena)
+{
+	struct StringView view = { token->start, token->size };
+	if (token->copied)
+		view = duplicateArenaView(arena, token->copy->data, token->size);
+
+	token->size = 0;
+	token->copied = 0;
+	token->noAlias = 0;
+	return view;
+}
+
+/* nothing but redirections so far */
+static int isEmptyCommand(const struct Command* command)
+{
+	return command->name.data == NULL && command->nAssignments == 0;
+}
+
+static int setCommandField(struct Command* command, struct Token* token, int currentState)
+{
+	if (command->body.data && token->size > 0)
+	{
+		/* TODO: specify location*/
+		fprintf(ERROR_OUTPUT, "Syntax error: unexpected word after function body.\n");
+		return 1;
+	}
+
+	switch (currentState)
+	{
+	case PARSING_STATE_COMMAND_NAME:
+		if (token->size == 0 && command->nAssignments == 0)
+		{
+			/* TODO: specify location*/
+			fprintf(ERROR_OUTPUT, "Syntax error: expected command name.\n");
+			return 1;
+		}
+
+		if (token->size == 0)
+			break;
+
+		/* "NAME=value" before the name is an assignment */
+		if (getAssignmentNameSize(token->copied ? token->copy->data : token->start, token->size))
+			addAssignment(command, takeToken(token, command->arena));
+		else
+			command->name = takeToken(token, command->arena);
+		break;
+
+	case PARSING_STATE_COMMAND_ARGS:
+		if(token->size > 0)
+			addArgument(command, takeToken(token, command->arena));
+		break;
+
+	case PARSING_STATE_COMMAND_INPUT:
+		if (token->size == 0)
+		{
+			/* TODO: specify location*/
+			fprintf(ERROR_OUTPUT, "Syntax error: expected input filename.\n");
+			return 1;
+		}
+
+		command->input = takeToken(token, command->arena);
+		break;
+
+	case PARSING_STATE_COMMAND_OUTPUT:
+		if (token->size == 0)
+		{
+			/* TODO: specify location*/
+			fprintf(ERROR_OUTPUT, "Syntax error: expected output filename.\n");
+			return 1;
+		}
+
+		command->output = takeToken(token, command->arena);
+		break;
+	}
+
+	return 0;
+}
+
+int isEscapingSlash(int squotes, int dquotes, int escaped, char nextSymbol)
+{
+	int escaping = 0;
+	if (squotes)
+	{
+		escaping = 0;
+	}
+	else if (dquotes)
+	{
+		if (escaped)
+		{
+			escaping = 0;
+		}
+		else
+		{
+			escaping = nextSymbol == '!' || nextSymbol == '"' || nextSymbol == '\\' || nextSymbol == '$';
+		}
+	}
+	else
+	{
+		escaping = !escaped;
+	}
+
+	return escaping;
+}
+
+static int isWordEnd(char symbol)
+{
+	return symbol == ' ' || symbol == ';' || symbol == '&' || symbol == '|' || symbol == '\n'
+		|| symbol == '\0' || symbol == '<' || symbol == '>';
+}
+
+/* "() {" after the name of a function, returns start of the body or NULL */
+static const char* skipFunctionHeader(const char* curr)
+{
+	++curr;
+	while (*curr == ' ')
+		++curr;
+
+	if (*curr != ')')
+		return NULL;
+
+	++curr;
+	while (*curr == ' ' || *curr == '\n')
+		++curr;
+
+	if (*curr != '{' || (curr[1] != ' ' && curr[1] != '\n'))
+		return NULL;
+
+	return curr + 1;
+}
+
+/* "<<word" or "<<-word", curr points after "<<". Quotes are removed from the delimiter,
+ * quoted one turns off expansion in the body. Returns symbol after the delimiter. */
+static const char* readDelimiter(const char* curr, struct String* delimiter, int* quoted, int* stripTabs)
+{
+	*stripTabs = *curr == '-';
+	if (*stripTabs)
+		++curr;
+
+	while (*curr == ' ')
+		++curr;
+
+	emptyString(delimiter);
+	*quoted = 0;
+	int squotes = 0;
+	int dquotes = 0;
+	for (; *curr && (squotes || dquotes || !isWordEnd(*curr)); ++curr)
+	{
+		if (*curr == '\'' && !dquotes)
+		{
+			squotes = !squotes;
+			*quoted = 1;
+		}
+		else if (*curr == '"' && !squotes)
+		{
+			dquotes = !dquotes;
+			*quoted = 1;
+		}
+		else if (*curr == '\\' && !squotes && curr[1])
+		{
+			addSymbol(delimiter, *++curr);
+			*quoted = 1;
+		}
+		else
+		{
+			addSymbol(delimiter, *curr);
+		}
+	}
+
+	return curr;
+}
+
+static const char* getNextLine(const char* curr)
+{
+	const char* newLine = strchr(curr, '\n');
+	return newLine ? newLine + 1 : curr + strlen(curr);
+}
+
+/* Body of a here-document starts at start and ends before the line with the delimiter (bodyEnd).
+ * Returns start of the line after the delimiter, or NULL if there is no such line. */
+static const char* findHereDocEnd(const char* start, const char* delimiter, int stripTabs, const char** bodyEnd)
+{
+	size_t size = strlen(delimiter);
+	for (const char* line = start; *line;)
+	{
+		const char* curr = line;
+		while (stripTabs && *curr == '\t')
+			++curr;
+
+		const char* next = getNextLine(curr);
+		const char* end = next > curr && next[-1] == '\n' ? next - 1 : next;
+		if ((size_t)(end - curr) == size && !memcmp(curr, delimiter, size))
+		{
+			*bodyEnd = line;
+			return next;
+		}
+
+		line = next;
+	}
+
+	return NULL;
+}
+
+/* Body is kept as a slice of the text unless tabs have to be removed or '$' marked. */
+static struct StringView takeHereDocBody(const char* start, const char* end, int expand, int stripTabs, struct Arena* arena)
+{
+	size_t size = (size_t)(end - start);
+	struct StringView view = { start, (int)size };
+	if (!stripTabs && (!expand || (!memchr(start, '$', size) && !memchr(start, '\\', size))))
+		return view;
+
+	struct String* s = createString();
+	int lineStart = 1;
+	for (const char* curr = start; curr < end; ++curr)
+	{
+		if (stripTabs && lineStart && *curr == '\t')
+			continue;
+
+		lineStart = *curr == '\n';
+		if (expand && *curr == '\\' && curr + 1 < end && strchr("$\\`\n", curr[1]))
+		{
+			/* escaped new line joins the lines */
+			if (*++curr != '\n')
+				addSymbol(s, *curr);
+		}
+		else
+		{
+			addSymbol(s, expand && *curr == '$' ? EXPANSION_MARK : *curr);
+		}
+	}
+
+	view = duplicateArenaView(arena, s->data, s->size);
+	freeString(s);
+	return view;
+}
+
+/* curr points after "<<". Body is taken from the lines after the command line, or after
+ * the previous here-document of the line, nextBody moves past its delimiter.
+ * Returns symbol after the delimiter, NULL in case of syntax error. */
+static const char* parseHereDocument(struct Command* command, const char* curr, const char** nextBody, struct String* delimiter)
+{
+	int quoted, stripTabs;
+	curr = readDelimiter(curr, delimiter, &quoted, &stripTabs);
+	if (!delimiter->size)
+	{
+		/* TODO: specify location*/
+		fprintf(ERROR_OUTPUT, "Syntax error: expected here-document delimiter.\n");
+		return NULL;
+	}
+
+	const char* start = *nextBody ? *nextBody : getNextLine(curr);
+	const char* bodyEnd;
+	const char* end = findHereDocEnd(start, delimiter->data, stripTabs, &bodyEnd);
+	if (!end)
+	{
+		fprintf(ERROR_OUTPUT, "warning: here-document delimited by end of file (wanted `%s')\n", delimiter->data);
+		bodyEnd = end = start + strlen(start);
+	}
+
+	command->input = takeHereDocBody(start, bodyEnd, !quoted, stripTabs, command->arena);
+	command->inputType = INPUT_HERE_DOCUMENT;
+	*nextBody = end;
+	return curr;
+}
+
+/* Returns ')' which closes "<(" or ">(", text starts after '('. Returns NULL if the text ends first. */
+static const char* findSubstitutionEnd(const char* text)
+{
+	int depth = 0;
+	int squotes = 0;
+	int dquotes = 0;
+	int escaped = 0;
+	for (const char* curr = text; *curr; ++curr)
+	{
+		if (escaped)
+			escaped = 0;
+		else if (*curr == '\\')
+			escaped = isEscapingSlash(squotes, dquotes, 0, curr[1]);
+		else if (*curr == '\'' && !dquotes)
+			squotes = !squotes;
+		else if (*curr == '"' && !squotes)
+			dquotes = !dquotes;
+		else if (squotes || dquotes)
+			continue;
+		else if (*curr == '(')
+			depth++;
+		else if (*curr == ')' && depth-- == 0)
+			return curr;
+	}
+
+	return NULL;
+}
+
+/* "<(list)" or ">(list)" becomes a word of SUBSTITUTION_MARK, direction and the list.
+ * Returns symbol after ')' or NULL on syntax error. */
+static const char* takeSubstitution(struct Token* token, const char* curr)
+{
+	const char* end = findSubstitutionEnd(curr + 2);
+	if (!end)
+	{
+		fprintf(ERROR_OUTPUT, "Syntax error: unexpected end of file while looking for matching \")\".\n");
+		return NULL;
+	}
+
+	if (!isWordEnd(end[1]))
+	{
+		/* TODO: specify location*/
+		fprintf(ERROR_OUTPUT, "Syntax error: unexpected token after \")\".\n");
+		return NULL;
+	}
+
+	addTokenReplacement(token, SUBSTITUTION_MARK);
+	addTokenSymbol(token, curr);
+	for (const char* symbol = curr + 2; symbol < end; ++symbol)
+		addTokenSymbol(token, symbol);
+
+	token->noAlias = 1;
+	return end + 1;
+}
+
+/* Returns '}' which closes the body the text starts in, or NULL if the text ends first.
+ * Braces count only as separate words: '{' after "()" or at the start of a command
+ * and '}' at the start of a command. Bodies of here-documents are skipped.
+ * open is set if the text ends inside a nested body or a here-document, the delimiter
+ * of which is copied to delimiter. */
+static const char* findBodyEnd(const char* text, int* open, struct String* delimiter)
+{
+	int depth = 0;
+	int squotes = 0;
+	int dquotes = 0;
+	int escaped = 0;
+	int commandStart = 1;
+	char last = '{'; /* last symbol which is not a space */
+	const char* hereDocEnd = NULL;
+	*open = 0;
+	for (const char* curr = text; *curr; ++curr)
+	{
+		char symbol = *curr;
+		int wordStart = curr == text || isspace((unsigned char)curr[-1]);
+		if (escaped)
+		{
+			escaped = 0;
+		}
+		else if (symbol == '\\')
+		{
+			escaped = isEscapingSlash(squotes, dquotes, 0, curr[1]);
+		}
+		else if (symbol == '\'' && !dquotes)
+		{
+			squotes = !squotes;
+		}
+		else if (symbol == '"' && !squotes)
+		{
+			dquotes = !dquotes;
+		}
+		else if (squotes || dquotes)
+		{
+		}
+		else if (symbol == '#' && wordStart)
+		{
+			while (curr[1] && curr[1] != '\n')
+				++curr;
+
+			continue;
+		}
+		else if (symbol == '\n' && hereDocEnd)
+		{
+			curr = hereDocEnd - 1;
+			hereDocEnd = NULL;
+			commandStart = 1;
+			continue;
+		}
+		else if (isspace((unsigned char)symbol))
+		{
+			commandStart |= symbol == '\n';
+			continue;
+		}
+		else if (symbol == '<' && curr[1] == '<' && curr[2] == '<')
+		{
+			curr += 2;
+		}
+		else if (symbol == '<' && curr[1] == '<')
+		{
+			int quoted, stripTabs;
+			struct String* word = createString();
+			const char* next = readDelimiter(curr + 2, word, &quoted, &stripTabs);
+			const char* bodyEnd;
+			hereDocEnd = findHereDocEnd(hereDocEnd ? hereDocEnd : getNextLine(next), word->data, stripTabs, &bodyEnd);
+			if (!hereDocEnd && word->size)
+			{
+				*open = 1;
+				if (delimiter)
+					addSymbols(delimiter, word->data, word->size);
+			}
+
+			freeString(word);
+			if (*open)
+				return NULL;
+
+			curr = next - 1;
+			commandStart = 0;
+			last = '<';
+			continue;
+		}
+		else if (symbol == '}' && wordStart && commandStart && isWordEnd(curr[1]))
+		{
+			if (depth == 0)
+				return curr;
+
+			depth--;
+			commandStart = 0;
+			last = symbol;
+			continue;
+		}
+		else if (symbol == '{' && wordStart && (commandStart || last == ')') && isspace((unsigned char)curr[1]))
+		{
+			depth++;
+			commandStart = 1;
+			last = symbol;
+			continue;
+		}
+
+		commandStart = !squotes && !dquotes && !escaped && (symbol == ';' || symbol == '&' || symbol == '|');
+		last = symbol;
+	}
+
+	*open = depth > 0;
+	return NULL;
+}
+
+int needsMoreLines(const char* text, struct String* delimiter)
+{
+	emptyString(delimiter);
+
+	/* '}' without an open body is skipped */
+	int open = 0;
+	for (const char* curr = text; curr && !open;)
+	{
+		curr = findBodyEnd(curr, &open, delimiter);
+		if (curr)
+			++curr;
+	}
+
+	return open;
+}
+
+struct Jobs* parseProgramm(const char* text, struct Arena* arena)
+{
+	TRACE(TRACE_BEGIN, "parse", 0, "size", strlen(text));
+
+	struct Jobs* jobs = createJobs(arena);
+	struct Job* job = createJob(arena);
+	struct Command* command = createCommand(arena);
+	struct Token tokenData = { text, 0, 0, createString(), 0 };
+	struct Token* token = &tokenData;
+
+	const char* currSymbol = text;
+	int escaped = 0;
+	int squotes = 0;
+	int dquotes = 0;
+	int state = PARSING_STATE_COMMAND_NAME;
+	int expansion = 0;
+	int afterExpansion = 0; /* previous symbol is a marked '$' */
+	int inParameter = 0;    /* inside "${...}" */
+	int parsingError = 0;
+	int finished = 0;
+
+	/* end of the last here-document of the current line */
+	const char* hereDocEnd = NULL;
+	struct String* delimiter = createString();
+
+	struct AliasFrame aliases[MAX_ALIAS_DEPTH];
+	int nAliases = 0;
+
+	while (!finished && !parsingError)
+	{
+		if (state == PARSING_STATE_COMMAND_NAME && token->size == 4 && !token->noAlias && job->size == 0 && !job->timed
+			&& isEmptyCommand(command) && !squotes && !dquotes && !escaped && isWordEnd(*currSymbol)
+			&& !memcmp(token->copied ? token->copy->data : token->start, "time", 4))
+		{
+			/* "time" keyword reports resources used by the whole pipeline */
+			job->timed = 1;
+			token->size = 0;
+			token->copied = 0;
+		}
+
+		if (state == PARSING_STATE_COMMAND_NAME && token->size > 0 && !token->noAlias
+			&& !squotes && !dquotes && !escaped && isWordEnd(*currSymbol))
+		{
+			/* command name is an alias, parse its text in place of the name */
+			const char* alias = findAlias(token->copied ? token->copy->data : token->start, token->size);
+			for (int i = 0; alias && i < nAliases; ++i)
+			{
+				if (aliases[i].alias == alias)
+					alias = NULL;
+			}
+
+			if (alias && nAliases < MAX_ALIAS_DEPTH)
+			{
+				aliases[nAliases].alias = alias;
+				aliases[nAliases].text = text;
+				aliases[nAliases].resume = currSymbol;
+				nAliases++;
+
+				/* words of the tree point into the text, so it lives in the arena */
+				text = currSymbol = duplicateArenaString(arena, alias);
+				token->size = 0;
+				token->copied = 0;
+				continue;
+			}
+
+			token->noAlias = 1;
+		}
+
+		switch (*currSymbol)
+		{
+		case '\\':
+		{
+			char nextSymbol = *(currSymbol + 1);
+			escaped = isEscapingSlash(squotes, dquotes, escaped, nextSymbol);
+			token->noAlias |= escaped;
+
+			if (!escaped || nextSymbol == '!')
+				addTokenSymbol(token, currSymbol);
+
+			++currSymbol;
+		}	continue;
+
+		case '$':
+			/* mark dollar signs which have to be expanded before run */
+			if (squotes || escaped)
+			{
+				addTokenSymbol(token, currSymbol);
+			}
+			else
+			{
+				addTokenReplacement(token, EXPANSION_MARK);
+				inParameter = *(currSymbol + 1) == '{';
+				expansion = 1;
+			}
+
+			++currSymbol;
+			break;
+
+		case '*':
+		case '?':
+		case '[':
+			/* mark symbols of unquoted patterns, "$?" and "${NAME[N]}" are parameters */
+			if (!squotes && !dquotes && !escaped && !afterExpansion && !inParameter)
+				addTokenReplacement(token, GLOB_MARK);
+
+			addTokenSymbol(token, currSymbol);
+			++currSymbol;
+			break;
+
+		case '}':
+			inParameter = 0;
+			addTokenSymbol(token, currSymbol);
+			++currSymbol;
+			break;
+
+		case '\'':
+			if (dquotes)
+				addTokenSymbol(token, currSymbol);
+			else
+				squotes = !squotes;
+
+			token->noAlias = 1;
+
+			++currSymbol;
+			break;
+
+		case '"':
+			if (squotes || escaped)
+				addTokenSymbol(token, currSymbol);
+			else
+				dquotes = !dquotes;
+
+			token->noAlias = 1;
+
+			++currSymbol;
+			break;
+
+		case '#':
+			if (!squotes && !dquotes && !escaped && (currSymbol == text || *(currSymbol - 1) == ' '))
+			{
+				/* skip comment*/
+				while (*currSymbol != '\n' && *currSymbol != '\0')
+					++currSymbol;
+			}
+			else
+			{
+				addTokenSymbol(token, currSymbol);
+				++currSymbol;
+			}
+
+			break;
+
+		case ' ':
+			if (squotes || dquotes)
+			{
+				addTokenSymbol(token, currSymbol);
+			}
+			else
+			{
+				if (token->size > 0)
+				{
+					parsingError = setCommandField(command, token, state);
+					state = command->name.data ? PARSING_STATE_COMMAND_ARGS : PARSING_STATE_COMMAND_NAME;
+				}
+			}
+
+			++currSymbol;
+			break;
+
+		case '(':
+		{
+			/* "name() { body }" or "name () { body }" */
+			const char* body = !squotes && !dquotes && !escaped ? skipFunctionHeader(currSymbol) : NULL;
+			int afterName = token->size > 0 ? state == PARSING_STATE_COMMAND_NAME && !command->name.data
+				: state == PARSING_STATE_COMMAND_ARGS && command->nArgs == 0;
+			if (!body || !afterName || command->nAssignments > 0 || command->body.data)
+			{
+				addTokenSymbol(token, currSymbol);
+				++currSymbol;
+				break;
+			}
+
+			if (token->size > 0)
+				command->name = takeToken(token, command->arena);
+
+			int open;
+			const char* end = findBodyEnd(body, &open, NULL);
+			if (!end)
+			{
+				fprintf(ERROR_OUTPUT, "Syntax error: unexpected end of file while looking for matching \"}\".\n");
+				parsingError = 1;
+				break;
+			}
+
+			command->body.data = body;
+			command->body.size = (int)(end - body);
+			state = PARSING_STATE_COMMAND_ARGS;
+			currSymbol = end + 1;
+		}	break;
+
+		case '<':
+			if (!squotes && !dquotes && !escaped && *(currSymbol + 1) == '(' && token->size == 0 && state != PARSING_STATE_COMMAND_NAME)
+			{
+				currSymbol = takeSubstitution(token, currSymbol);
+				parsingError = !currSymbol;
+				break;
+			}
+
+			if (!squotes && !dquotes && !escaped)
+			{
+				parsingError = setCommandField(command, token, state);
+				if (*(currSymbol + 1) == '<' && *(currSymbol + 2) == '<')
+				{
+					/* "<<<word" */
+					command->inputType = INPUT_HERE_STRING;
+					state = PARSING_STATE_COMMAND_INPUT;
+					currSymbol += 2;
+				}
+				else if (*(currSymbol + 1) == '<')
+				{
+					const char* next = parsingError ? NULL : parseHereDocument(command, currSymbol + 2, &hereDocEnd, delimiter);
+					parsingError = !next;
+					state = command->name.data ? PARSING_STATE_COMMAND_ARGS : PARSING_STATE_COMMAND_NAME;
+					currSymbol = next;
+					break;
+				}
+				else
+				{
+					command->inputType = INPUT_FILE;
+					state = PARSING_STATE_COMMAND_INPUT;
+				}
+			}
+			else
+			{
+				addTokenSymbol(token, currSymbol);
+			}
+
+			++currSymbol;
+			break;
+
+		case '>':
+			if (!squotes && !dquotes && !escaped && *(currSymbol + 1) == '(' && token->size == 0 && state != PARSING_STATE_COMMAND_NAME)
+			{
+				currSymbol = takeSubstitution(token, currSymbol);
+				parsingError = !currSymbol;
+				break;
+			}
+
+			if (!squotes && !dquotes && !escaped)
+			{
+				parsingError = setCommandField(command, token, state);
+				state = PARSING_STATE_COMMAND_OUTPUT;
+
+				command->rewriteOutput = 1;
+				if (*(currSymbol + 1) == '>')
+				{
+					command->rewriteOutput = 0;
+					++currSymbol;
+				}
+			}
+			else
+			{
+				addTokenSymbol(token, currSymbol);
+			}
+
+			++currSymbol;
+			break;
+
+		case '|':
+			if (!squotes && !dquotes && !escaped)
+			{
+				parsingError = setCommandField(command, token, state);
+				addCommand(job, command);
+				command = createCommand(arena);
+				state = PARSING_STATE_COMMAND_NAME;
+			}
+			else
+			{
+				addTokenSymbol(token, currSymbol);
+			}
+
+			++currSymbol;
+			break;
+
+		case ';':
+		case '&':
+		case '\n':
+			if (!squotes && !dquotes && !escaped)
+			{
+				if (!(job->size == 0 && isEmptyCommand(command) && token->size == 0))
+				{
+					job->background = *currSymbol == '&';
+					parsingError = setCommandField(command, token, state);
+					addCommand(job, command);
+					addJob(jobs, job);
+					command = createCommand(arena);
+					job = createJob(arena);
+					state = PARSING_STATE_COMMAND_NAME;
+				}
+				else if (*currSymbol == '&')
+				{
+					/* TODO: specify location*/
+					fprintf(ERROR_OUTPUT, "Syntax error: unexpected token \"&\".\n");
+					parsingError = 1;
+				}
+				else
+				{
+					/* "time" without a pipeline */
+					job->timed = 0;
+				}
+			}
+			else
+			{
+				/* do not add escaped line endings */
+				if (*currSymbol != '\n' || !escaped)
+					addTokenSymbol(token, currSymbol);
+			}
+
+			if (*currSymbol == '\n' && hereDocEnd && !squotes && !dquotes && !escaped)
+			{
+				/* lines of here-documents are not commands */
+				currSymbol = hereDocEnd;
+				hereDocEnd = NULL;
+				break;
+			}
+
+			++currSymbol;
+			break;
+
+		case '\0':
+			if (nAliases > 0)
+			{
+				/* end of the alias text, continue after its name */
+				nAliases--;
+				text = aliases[nAliases].text;
+				currSymbol = aliases[nAliases].resume;
+				token->noAlias = token->size > 0;
+				continue;
+			}
+
+			if (!squotes && !dquotes)
+			{
+				if (!(job->size == 0 && isEmptyCommand(command) && token->size == 0))
+				{
+					parsingError = setCommandField(command, token, state);
+					addCommand(job, command);
+					addJob(jobs, job);
+					job = NULL;
+					command = NULL;
+				}
+			}
+			else
+			{
+				fprintf(ERROR_OUTPUT, "Syntax error : unexpected end of file while looking for matching %s.\n", squotes ? "'" : "\"");
+				parsingError = 1;
+			}
+
+			finished = 1;
+			break;
+
+		default:
+			addTokenSymbol(token, currSymbol);
+			++currSymbol;
+			break;
+		}
+
+		escaped = 0;
+		afterExpansion = expansion;
+		expansion = 0;
+	}
+
+	freeString(token->copy);
+	freeString(delimiter);
+
+	TRACE(TRACE_END, "parse", 0, "jobs", jobs->size);
+
+	/* nodes of a broken tree are released with the arena */
+	return parsingError ? NULL : jobs;
+}
@@ -0,0 +1,17 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "job.h"
+
+/* Returns 1 if '\\' escapes the next symbol in the current quoting context. */
+int isEscapingSlash(int squotes, int dquotes, int escaped, char nextSymbol);
+
+/* Returns 1 if the text ends inside a function body or a here-document, so the next
+ * line continues it. Delimiter of the unfinished here-document is copied to delimiter,
+ * which stays empty otherwise. */
+int needsMoreLines(const char* text, struct String* delimiter);
+
+/* Builds the parse tree in the arena. Returns NULL in case of syntax error. */
+struct Jobs* parseProgramm(const char* text, struct Arena* arena);
+
+#endif
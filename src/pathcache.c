@@ -0,0 +1,153 @@
+#include "pathcache.h"
+#include "utils.h"
+#include "variables.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <linux/limits.h>
+
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+struct HashedCommand
+{
+	char* path;
+	int hits;
+};
+
+static struct HashTable* g_commandHash = NULL;
+
+/* value of $PATH the table was filled for */
+static char* g_hashedPath = NULL;
+
+static void freeHashedCommand(void* value)
+{
+	struct HashedCommand* command = value;
+	free(command->path);
+	free(command);
+}
+
+void initCommandHash()
+{
+	g_commandHash = createHashTable(freeHashedCommand);
+}
+
+void freeCommandHash()
+{
+	freeHashTable(g_commandHash);
+	g_commandHash = NULL;
+
+	free(g_hashedPath);
+	g_hashedPath = NULL;
+}
+
+static int isExecutable(const char* path)
+{
+	struct stat st;
+	return !stat(path, &st) && S_ISREG(st.st_mode) && !access(path, X_OK);
+}
+
+static char* searchPath(const char* name, const char* pathVar)
+{
+	size_t nameLength = strlen(name);
+	char candidate[PATH_MAX];
+
+	const char* dir = pathVar;
+	while (1)
+	{
+		const char* end = strchr(dir, ':');
+		size_t dirLength = end ? (size_t)(end - dir) : strlen(dir);
+
+		/* empty entry means current directory */
+		if (dirLength == 0)
+		{
+			dir = ".";
+			dirLength = 1;
+		}
+
+		if (dirLength + nameLength + 2 <= sizeof(candidate))
+		{
+			memcpy(candidate, dir, dirLength);
+			candidate[dirLength] = '/';
+			memcpy(candidate + dirLength + 1, name, nameLength + 1);
+
+			if (isExecutable(candidate))
+				return duplicateString(candidate);
+		}
+
+		if (!end)
+			break;
+
+		dir = end + 1;
+	}
+
+	return NULL;
+}
+
+const char* hashCommand(const char* name)
+{
+	if (strchr(name, '/'))
+		return name;
+
+	const char* pathVar = getVariable("PATH");
+	if (!pathVar)
+		pathVar = DEFAULT_PATH;
+
+	/* locations are only valid for the $PATH they were found in */
+	if (!g_hashedPath || strcmp(g_hashedPath, pathVar))
+	{
+		clearCommandHash();
+		g_hashedPath = duplicateString(pathVar);
+	}
+
+	struct HashedCommand* command = getHashTableValue(g_commandHash, name);
+	if (!command)
+	{
+		char* path = searchPath(name, pathVar);
+		if (!path)
+			return NULL;
+
+		command = malloc(sizeof(struct HashedCommand));
+		command->path = path;
+		command->hits = 0;
+		setHashTableValue(g_commandHash, name, command);
+	}
+
+	command->hits++;
+	return command->path;
+}
+
+int forgetCommand(const char* name)
+{
+	return removeHashTableValue(g_commandHash, name);
+}
+
+void clearCommandHash()
+{
+	emptyHashTable(g_commandHash);
+
+	free(g_hashedPath);
+	g_hashedPath = NULL;
+}
+
+void printCommandHash()
+{
+	if (!g_commandHash || !g_commandHash->size)
+	{
+		printf("hash: hash table empty\n");
+		return;
+	}
+
+	printf("hits\tcommand\n");
+	for (int i = 0; i < g_commandHash->capacity; ++i)
+	{
+		for (const struct HashEntry* entry = g_commandHash->buckets[i]; entry; entry = entry->next)
+		{
+			const struct HashedCommand* command = entry->value;
+			printf("%4d\t%s\n", command->hits, command->path);
+		}
+	}
+}
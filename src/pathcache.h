@@ -0,0 +1,20 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+/* Remembered locations of commands found in $PATH (see "hash" in bash). */
+
+void initCommandHash();
+void freeCommandHash();
+
+/* Returns full path of the command, searching $PATH only on the first use.
+ * Names containing '/' are returned as is. Returns NULL if nothing is found. */
+const char* hashCommand(const char* name);
+
+/* Drops remembered location, e.g. when cached file has disappeared.
+ * Returns 1 if the command was in the table. */
+int forgetCommand(const char* name);
+
+void clearCommandHash();
+void printCommandHash();
+
+#endif
@@ -0,0 +1,322 @@
+#include "process.h"
+#include "trace.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define MIN_TABLE_SIZE 16
+
+#define SLOT_EMPTY 0
+#define SLOT_REMOVED -1
+
+/* open addressing table: pid -> (pipeline, stage) */
+struct ProcessSlot
+{
+	pid_t pid;
+	struct Pipeline* pipeline;
+	int stage;
+};
+
+struct ProcessTable
+{
+	struct ProcessSlot* slots;
+	int size;
+	int used; /* occupied and removed slots */
+	int capacity;
+};
+
+static struct ProcessTable g_processTable = { NULL, 0, 0, 0 };
+
+static unsigned int hashPid(pid_t pid)
+{
+	return (unsigned int)pid * 2654435761u;
+}
+
+static struct ProcessSlot* findProcessSlot(pid_t pid)
+{
+	if (!g_processTable.capacity)
+		return NULL;
+
+	unsigned int mask = (unsigned int)g_processTable.capacity - 1;
+	for (unsigned int i = hashPid(pid) & mask;; i = (i + 1) & mask)
+	{
+		struct ProcessSlot* slot = &g_processTable.slots[i];
+		if (slot->pid == pid)
+			return slot;
+
+		if (slot->pid == SLOT_EMPTY)
+			return NULL;
+	}
+}
+
+static void insertProcessSlot(pid_t pid, struct Pipeline* pipeline, int stage)
+{
+	if ((g_processTable.used + 1) * 4 > g_processTable.capacity * 3)
+	{
+		/* rehash dropping removed slots */
+		struct ProcessSlot* oldSlots = g_processTable.slots;
+		int oldCapacity = g_processTable.capacity;
+
+		int newCapacity = max(MIN_TABLE_SIZE, oldCapacity);
+		while (g_processTable.size * 2 >= newCapacity)
+			newCapacity *= 2;
+
+		g_processTable.slots = calloc((size_t)newCapacity, sizeof(struct ProcessSlot));
+		if (!g_processTable.slots)
+		{
+			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+			exit(1);
+		}
+
+		g_processTable.capacity = newCapacity;
+		g_processTable.size = g_processTable.used = 0;
+
+		for (int i = 0; i < oldCapacity; ++i)
+		{
+			if (oldSlots[i].pid > 0)
+				insertProcessSlot(oldSlots[i].pid, oldSlots[i].pipeline, oldSlots[i].stage);
+		}
+
+		free(oldSlots);
+	}
+
+	unsigned int mask = (unsigned int)g_processTable.capacity - 1;
+	unsigned int i = hashPid(pid) & mask;
+	while (g_processTable.slots[i].pid > 0)
+		i = (i + 1) & mask;
+
+	if (g_processTable.slots[i].pid == SLOT_EMPTY)
+		g_processTable.used++;
+
+	g_processTable.slots[i].pid = pid;
+	g_processTable.slots[i].pipeline = pipeline;
+	g_processTable.slots[i].stage = stage;
+	g_processTable.size++;
+}
+
+static void sigChildHandler(int sig)
+{
+	int savedErrno = errno;
+
+	int wstatus;
+	struct rusage usage;
+	pid_t wpid;
+	while ((wpid = wait4(-1, &wstatus, WNOHANG | WUNTRACED, &usage)) > 0)
+		recordProcessStatus(wpid, wstatus, &usage);
+
+	errno = savedErrno;
+}
+
+void initProcessTable()
+{
+	memset(&g_processTable, 0, sizeof(g_processTable));
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = sigChildHandler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGCHLD, &action, NULL);
+}
+
+void freeProcessTable()
+{
+	signal(SIGCHLD, SIG_DFL);
+
+	free(g_processTable.slots);
+	memset(&g_processTable, 0, sizeof(g_processTable));
+}
+
+void blockChildSignal(sigset_t* oldMask)
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, oldMask);
+}
+
+void restoreSignalMask(const sigset_t* oldMask)
+{
+	sigprocmask(SIG_SETMASK, oldMask, NULL);
+}
+
+struct Pipeline* createPipeline(int size)
+{
+	struct Pipeline* pipeline = malloc(sizeof(struct Pipeline));
+	pipeline->pids = malloc((size_t)max(size, 1) * sizeof(pid_t));
+	pipeline->statuses = malloc((size_t)max(size, 1) * sizeof(int));
+	pipeline->usages = calloc((size_t)max(size, 1), sizeof(struct StageUsage));
+	for (int i = 0; i < size; ++i)
+	{
+		pipeline->pids[i] = -1;
+		pipeline->statuses[i] = 0;
+	}
+
+	/* stages which do not run anything end right at the start */
+	clock_gettime(CLOCK_MONOTONIC, &pipeline->start);
+	for (int i = 0; i < size; ++i)
+		pipeline->usages[i].end = pipeline->start;
+
+	pipeline->size = size;
+	pipeline->nRunning = 0;
+	pipeline->nStopped = 0;
+	pipeline->pgid = 0;
+	pipeline->timed = 0;
+	pipeline->substitutions = NULL;
+	return pipeline;
+}
+
+void freePipeline(struct Pipeline* pipeline)
+{
+	if (!pipeline)
+		return;
+
+	sigset_t oldMask;
+	blockChildSignal(&oldMask);
+
+	/* forget processes which are still in the table */
+	for (int i = 0; i < pipeline->size; ++i)
+	{
+		struct ProcessSlot* slot = pipeline->pids[i] != -1 ? findProcessSlot(pipeline->pids[i]) : NULL;
+		if (slot)
+		{
+			slot->pid = SLOT_REMOVED;
+			g_processTable.size--;
+		}
+	}
+
+	restoreSignalMask(&oldMask);
+
+	freePipeline(pipeline->substitutions);
+	free(pipeline->pids);
+	free(pipeline->statuses);
+	free(pipeline->usages);
+	free(pipeline);
+}
+
+void addPipelineProcess(struct Pipeline* pipeline, int stage, pid_t pid)
+{
+	pipeline->pids[stage] = pid;
+	pipeline->nRunning++;
+	insertProcessSlot(pid, pipeline, stage);
+}
+
+void setPipelineStatus(struct Pipeline* pipeline, int stage, int status)
+{
+	pipeline->statuses[stage] = status;
+}
+
+void setPipelineUsage(struct Pipeline* pipeline, int stage, const struct rusage* usage)
+{
+	pipeline->usages[stage].rusage = *usage;
+	clock_gettime(CLOCK_MONOTONIC, &pipeline->usages[stage].end);
+}
+
+int recordProcessStatus(pid_t pid, int wstatus, const struct rusage* usage)
+{
+	struct ProcessSlot* slot = findProcessSlot(pid);
+	if (!slot)
+		return 0;
+
+	struct Pipeline* pipeline = slot->pipeline;
+	int stage = slot->stage;
+
+	if (WIFSTOPPED(wstatus))
+	{
+		TRACE(TRACE_INSTANT, "stop", pid, "stage", stage);
+		pipeline->nStopped++;
+		return 1;
+	}
+
+	slot->pid = SLOT_REMOVED;
+	g_processTable.size--;
+
+	if (WIFEXITED(wstatus))
+		pipeline->statuses[stage] = WEXITSTATUS(wstatus);
+	else if (WIFSIGNALED(wstatus))
+		pipeline->statuses[stage] = 128 + WTERMSIG(wstatus);
+
+	/* clock_gettime is safe in a signal handler */
+	setPipelineUsage(pipeline, stage, usage);
+	TRACE(TRACE_INSTANT, "exit", pid, "status", pipeline->statuses[stage]);
+
+	pipeline->pids[stage] = -1;
+	pipeline->nRunning--;
+	return 1;
+}
+
+/* substitutions are waited for too, the shell holds no ends of their pipes */
+static int isPipelineRunning(const struct Pipeline* pipeline)
+{
+	const struct Pipeline* substitutions = pipeline->substitutions;
+	if (pipeline->nStopped || (substitutions && substitutions->nStopped))
+		return 0;
+
+	return pipeline->nRunning > 0 || (substitutions && substitutions->nRunning > 0);
+}
+
+void waitPipeline(struct Pipeline* pipeline)
+{
+	sigset_t oldMask;
+	blockChildSignal(&oldMask);
+
+	/* statuses are stored by SIGCHLD handler, sleep until it runs */
+	sigset_t waitMask = oldMask;
+	sigdelset(&waitMask, SIGCHLD);
+	while (isPipelineRunning(pipeline))
+		sigsuspend(&waitMask);
+
+	restoreSignalMask(&oldMask);
+}
+
+void signalPipeline(const struct Pipeline* pipeline, int sig)
+{
+	if (pipeline->pgid > 0)
+	{
+		kill(-pipeline->pgid, sig);
+		return;
+	}
+
+	for (int i = 0; i < pipeline->size; ++i)
+	{
+		if (pipeline->pids[i] != -1)
+			kill(pipeline->pids[i], sig);
+	}
+
+	if (pipeline->substitutions)
+		signalPipeline(pipeline->substitutions, sig);
+}
+
+void continuePipeline(struct Pipeline* pipeline)
+{
+	pipeline->nStopped = 0;
+	if (pipeline->substitutions)
+		pipeline->substitutions->nStopped = 0;
+
+	signalPipeline(pipeline, SIGCONT);
+}
+
+int getPipelineStatus(const struct Pipeline* pipeline, int pipefail)
+{
+	if (!pipeline->size)
+		return 0;
+
+	if (pipefail)
+	{
+		for (int i = pipeline->size - 1; i >= 0; --i)
+		{
+			if (pipeline->statuses[i])
+				return pipeline->statuses[i];
+		}
+
+		return 0;
+	}
+
+	return pipeline->statuses[pipeline->size - 1];
+}
@@ -0,0 +1,68 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+/* Resources used by a finished stage. */
+struct StageUsage
+{
+	struct rusage rusage;
+	struct timespec end; /* CLOCK_MONOTONIC */
+};
+
+/* Processes started for one pipeline. Every stage keeps its exit status. */
+struct Pipeline
+{
+	pid_t* pids;
+	int* statuses;
+	struct StageUsage* usages;
+	struct timespec start; /* CLOCK_MONOTONIC */
+	int timed; /* usage is reported when the job finishes, decided when it starts */
+	int size;
+	int nRunning;
+	int nStopped;
+	pid_t pgid;
+
+	/* lists of "<(list)" and ">(list)" words, each one runs in a forked shell */
+	struct Pipeline* substitutions;
+};
+
+struct Pipeline* createPipeline(int size);
+void freePipeline(struct Pipeline* pipeline);
+
+/* Registers started process of the stage so its status can be found by pid. */
+void addPipelineProcess(struct Pipeline* pipeline, int stage, pid_t pid);
+
+/* Sets status of a stage which did not start a process (builtins, failed launches). */
+void setPipelineStatus(struct Pipeline* pipeline, int stage, int status);
+/* Sets resources used by a stage which ran inside the shell. */
+void setPipelineUsage(struct Pipeline* pipeline, int stage, const struct rusage* usage);
+
+/* Stores wait status and resource usage of a reaped or stopped child in the pipeline it belongs to.
+ * Returns 0 if the pid is unknown. Safe to call from a signal handler. */
+int recordProcessStatus(pid_t pid, int wstatus, const struct rusage* usage);
+
+/* Blocks until every process of the pipeline has finished or one of them has stopped. */
+void waitPipeline(struct Pipeline* pipeline);
+
+/* Sends the signal to the process group of the pipeline or to every its process. */
+void signalPipeline(const struct Pipeline* pipeline, int sig);
+
+/* Resumes stopped processes of the pipeline. */
+void continuePipeline(struct Pipeline* pipeline);
+
+/* Children are reaped by SIGCHLD handler, the table must not be changed
+ * from the outside while the signal is not blocked. */
+void blockChildSignal(sigset_t* oldMask);
+void restoreSignalMask(const sigset_t* oldMask);
+
+/* Status of the last stage, or of the last failed one in pipefail mode. */
+int getPipelineStatus(const struct Pipeline* pipeline, int pipefail);
+
+void initProcessTable();
+void freeProcessTable();
+
+#endif
@@ -0,0 +1,274 @@
+#include "jobtable.h"
+#include "prompt.h"
+#include "utils.h"
+#include "variables.h"
+
+#include <limits.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/limits.h>
+
+extern int g_lastStatus;
+
+#define DEFAULT_PROMPT "\\u:\\w$ "
+
+/* parts of the prompt which may change after every command */
+#define USES_STATUS 1
+#define USES_JOBS 2
+#define USES_TIME 4
+
+struct Prompt
+{
+	char* user;
+	char* host;
+	char* directory; /* NULL until read after "cd" */
+	char* home;      /* $HOME the shown directory was abbreviated with */
+	char* shownDirectory;
+	int root;
+
+	/* the rendered text and everything it was rendered from */
+	struct String* text;
+	char* format;
+	int uses;
+	int status;
+	int nJobs;
+	long commandMs;
+	int valid;
+};
+
+static struct Prompt g_prompt;
+static long g_commandMs = 0;
+
+void initPrompt()
+{
+	memset(&g_prompt, 0, sizeof(g_prompt));
+
+	/* getlogin may read utmp, so it is called only once */
+	const char* user = getlogin();
+	if (!user)
+	{
+		struct passwd* pw = getpwuid(geteuid());
+		user = pw ? pw->pw_name : NULL;
+	}
+
+	g_prompt.user = duplicateString(user ? user : "unknown_user");
+
+	char host[HOST_NAME_MAX + 1];
+	if (gethostname(host, sizeof(host)) == -1)
+		host[0] = '\0';
+
+	host[HOST_NAME_MAX] = '\0';
+	g_prompt.host = duplicateString(host);
+	g_prompt.root = geteuid() == 0;
+	g_prompt.text = createString();
+}
+
+void freePrompt()
+{
+	free(g_prompt.user);
+	free(g_prompt.host);
+	free(g_prompt.directory);
+	free(g_prompt.home);
+	free(g_prompt.shownDirectory);
+	free(g_prompt.format);
+	freeString(g_prompt.text);
+	memset(&g_prompt, 0, sizeof(g_prompt));
+}
+
+void invalidatePromptDirectory()
+{
+	free(g_prompt.directory);
+	g_prompt.directory = NULL;
+	g_prompt.valid = 0;
+}
+
+void setPromptCommandTime(double seconds)
+{
+	g_commandMs = (long)(seconds * 1000);
+}
+
+static int isSameString(const char* left, const char* right)
+{
+	return left == right || (left && right && !strcmp(left, right));
+}
+
+/* directory with $HOME replaced by '~' */
+static void updateDirectory()
+{
+	const char* home = getVariable("HOME");
+	if (g_prompt.directory && g_prompt.shownDirectory && isSameString(home, g_prompt.home))
+		return;
+
+	if (!g_prompt.directory)
+	{
+		char cwd[PATH_MAX];
+		const char* path = getcwd(cwd, sizeof(cwd));
+		g_prompt.directory = duplicateString(path ? path : "");
+	}
+
+	free(g_prompt.home);
+	free(g_prompt.shownDirectory);
+	g_prompt.home = duplicateString(home);
+	g_prompt.valid = 0;
+
+	const char* directory = g_prompt.directory;
+	size_t homeSize = home ? strlen(home) : 0;
+	if (homeSize > 1 && !strncmp(directory, home, homeSize) && (directory[homeSize] == '/' || directory[homeSize] == '\0'))
+	{
+		g_prompt.shownDirectory = malloc(strlen(directory) - homeSize + 2);
+		g_prompt.shownDirectory[0] = '~';
+		strcpy(g_prompt.shownDirectory + 1, directory + homeSize);
+	}
+	else
+	{
+		g_prompt.shownDirectory = duplicateString(directory);
+	}
+}
+
+static void addText(struct String* s, const char* text)
+{
+	addSymbols(s, text, (int)strlen(text));
+}
+
+static void addNumber(struct String* s, long value)
+{
+	char buffer[32];
+	addSymbols(s, buffer, snprintf(buffer, sizeof(buffer), "%ld", value));
+}
+
+static void addDuration(struct String* s, long ms)
+{
+	char buffer[64];
+	int size;
+	if (ms < 1000)
+		size = snprintf(buffer, sizeof(buffer), "%ldms", ms);
+	else if (ms < 60000)
+		size = snprintf(buffer, sizeof(buffer), "%ld.%lds", ms / 1000, ms % 1000 / 100);
+	else
+		size = snprintf(buffer, sizeof(buffer), "%ldm%lds", ms / 60000, ms % 60000 / 1000);
+
+	addSymbols(s, buffer, size);
+}
+
+static void render(const char* format)
+{
+	struct String* s = g_prompt.text;
+	emptyString(s);
+
+	for (const char* curr = format; *curr; ++curr)
+	{
+		if (*curr != '\\' || curr[1] == '\0')
+		{
+			addSymbol(s, *curr);
+			continue;
+		}
+
+		++curr;
+		switch (*curr)
+		{
+		case 'u':
+			addText(s, g_prompt.user);
+			break;
+		case 'h':
+			addSymbols(s, g_prompt.host, (int)strcspn(g_prompt.host, "."));
+			break;
+		case 'H':
+			addText(s, g_prompt.host);
+			break;
+		case 'w':
+			addText(s, g_prompt.shownDirectory);
+			break;
+		case 'W':
+		{
+			/* "/" and "~" are shown as they are */
+			const char* directory = g_prompt.shownDirectory;
+			const char* slash = strrchr(directory, '/');
+			addText(s, slash && slash[1] ? slash + 1 : directory);
+			break;
+		}
+		case '?':
+			addNumber(s, g_prompt.status);
+			break;
+		case 'j':
+			addNumber(s, g_prompt.nJobs);
+			break;
+		case 'L':
+			addDuration(s, g_prompt.commandMs);
+			break;
+		case '$':
+			addSymbol(s, g_prompt.root ? '#' : '$');
+			break;
+		case 'n':
+			addSymbol(s, '\n');
+			break;
+		case '\\':
+			addSymbol(s, '\\');
+			break;
+		case '[':
+		case ']':
+			break;
+		default:
+			addSymbol(s, '\\');
+			addSymbol(s, *curr);
+			break;
+		}
+	}
+}
+
+static int getUsedParts(const char* format)
+{
+	int uses = 0;
+	for (const char* curr = strchr(format, '\\'); curr && curr[1]; curr = strchr(curr + 2, '\\'))
+	{
+		if (curr[1] == '?')
+			uses |= USES_STATUS;
+		else if (curr[1] == 'j')
+			uses |= USES_JOBS;
+		else if (curr[1] == 'L')
+			uses |= USES_TIME;
+	}
+
+	return uses;
+}
+
+void printPrompt()
+{
+	const char* format = getVariable("PS1");
+	if (!format)
+		format = DEFAULT_PROMPT;
+
+	if (!isSameString(format, g_prompt.format))
+	{
+		free(g_prompt.format);
+		g_prompt.format = duplicateString(format);
+		g_prompt.uses = getUsedParts(format);
+		g_prompt.valid = 0;
+	}
+
+	updateDirectory();
+
+	int uses = g_prompt.uses;
+	if (((uses & USES_STATUS) && g_prompt.status != g_lastStatus)
+		|| ((uses & USES_JOBS) && g_prompt.nJobs != getBackgroundJobsCount())
+		|| ((uses & USES_TIME) && g_prompt.commandMs != g_commandMs))
+	{
+		g_prompt.valid = 0;
+	}
+
+	if (!g_prompt.valid)
+	{
+		g_prompt.status = g_lastStatus;
+		g_prompt.nJobs = getBackgroundJobsCount();
+		g_prompt.commandMs = g_commandMs;
+		render(format);
+		g_prompt.valid = 1;
+	}
+
+	/* output of builtins may still be buffered */
+	fflush(stdout);
+	writeAll(STDOUT_FILENO, g_prompt.text->data, g_prompt.text->size);
+}
@@ -0,0 +1,25 @@
+#ifndef PROMPT_H
+#define PROMPT_H
+
+/* Prompt of an interactive shell built from $PS1 ("\u:\w$ " if not set):
+ *   \u - user name       \h - host name up to the first '.'   \H - host name
+ *   \w - current directory, $HOME replaced with '~'           \W - its last component
+ *   \? - exit status of the last job                          \j - number of background jobs
+ *   \L - time the last command line took                      \$ - '#' for root, '$' otherwise
+ *   \n - new line        \\ - backslash                       \[ \] - ignored
+ * User and host are read once, the directory after every successful "cd".
+ * The text is rendered again only when one of its parts changes. */
+
+void initPrompt();
+void freePrompt();
+
+/* Writes the prompt to stdout with a single write. */
+void printPrompt();
+
+/* Called when the current directory changes. */
+void invalidatePromptDirectory();
+
+/* Time of the last command line for \L. */
+void setPromptCommandTime(double seconds);
+
+#endif
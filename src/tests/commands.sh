@@ -0,0 +1,23 @@
+#!/bin/sh
+# Lookup and start of external commands.
+
+. "$(dirname "$0")/lib.sh"
+
+# executable text file without "#!" runs with /bin/sh
+printf 'echo "$0" "$#" "$2"\n' > "$DIR/noshebang"
+chmod +x "$DIR/noshebang"
+check script_without_interpreter "./noshebang 2 b c
+0" <<'END'
+./noshebang a 'b c'
+echo $?
+END
+
+# file which is not executable is still an error
+printf 'echo text\n' > "$DIR/text"
+check not_executable "./text: Permission denied
+126" <<'END'
+./text
+echo $?
+END
+
+finish
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Shell functions and parse trees kept for them.
+
+. "$(dirname "$0")/lib.sh"
+
+# defining a function does not drop the parsed lines which do not depend on it
+check redefinition_keeps_cache "$(printf 'x\nx\nhits\tmisses\tlines\n3\t4\t4')" <<'END'
+g() { /bin/true; }
+echo x
+g() { /bin/true; }
+echo x
+parsecache
+END
+
+# body optimized before "cat" became a function calls the function afterwards
+echo hello > "$DIR/h.txt"
+check cat_defined_later 'HELLO
+FN
+HELLO' <<'END'
+f() { cat h.txt | tr a-z A-Z; }
+f
+cat() { echo FN; }
+f
+unset -f cat
+f
+END
+
+finish
@@ -0,0 +1,37 @@
+#!/bin/sh
+# History file of interactive sessions, run in a terminal created by script(1).
+
+. "$(dirname "$0")/lib.sh"
+
+if ! command -v script > /dev/null; then
+	echo "$NAME: skipped, script(1) is not installed"
+	exit 0
+fi
+
+# session: runs an interactive shell with the input from stdin and the history file in $DIR
+session()
+{
+	HISTFILE="$DIR/history" timeout 10 script -qec "$SHELL_BIN" /dev/null > /dev/null
+}
+
+# a here-document is one entry after the file is loaded again and can be recalled
+printf 'cat > %s/out <<END\nhello\nEND\n' "$DIR" | session
+rm -f "$DIR/out"
+printf 'history > %s/list\n!1\n' "$DIR" | session
+compare heredoc_entries "#1: cat > $DIR/out <<END
+hello
+END
+#2: history > $DIR/list" "$(cat "$DIR/list" 2>&1)"
+compare heredoc_recall hello "$(cat "$DIR/out" 2>&1)"
+
+# escaped new line is restored with its slash
+rm -f "$DIR/history" "$DIR/out"
+printf 'echo a \\\nb > %s/out\n' "$DIR" | session
+rm -f "$DIR/out"
+printf 'history > %s/list\n!1\n' "$DIR" | session
+compare continuation_entries "#1: echo a \\
+b > $DIR/out
+#2: history > $DIR/list" "$(cat "$DIR/list" 2>&1)"
+compare continuation_recall 'a b' "$(cat "$DIR/out" 2>&1)"
+
+finish
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Background jobs and their listing.
+
+. "$(dirname "$0")/lib.sh"
+
+# only an interactive shell prints "[N] pid" for a started job
+check no_job_number '' <<'END'
+/bin/true &
+END
+
+# a finished job is reported once
+check done_once '[1]  Done      sleep 0.1' <<'END'
+sleep 0.1 & sleep 0.3; jobs
+END
+
+check running_and_done '[2]  Running   sleep 1
+[1]  Done      sleep 0.1
+[2]  Done      sleep 1' <<'END'
+sleep 0.1 & sleep 1 & sleep 0.3; jobs; wait
+END
+
+# a job which has already finished can still be waited for, by pid or by number
+check wait_finished_pid 'st=5' <<'END'
+sh -c "exit 5" &
+/bin/sleep 0.2
+wait $!
+echo st=$?
+END
+
+check wait_finished_number 'st=6' <<'END'
+sh -c "exit 6" &
+/bin/sleep 0.2
+wait %1
+echo st=$?
+END
+
+finish
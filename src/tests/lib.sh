@@ -0,0 +1,51 @@
+# Common part of the scripts in tests, sourced by every one of them.
+# Usage of a test script: tests/<name>.sh [shell binary]
+# Prints "<name>: <test> ok" or "FAIL" lines, "finish" exits with 1 if one has failed.
+
+NAME=$(basename "$0" .sh)
+SHELL_BIN=${1:-./shell}
+# scripts run in the temporary directory
+case $SHELL_BIN in
+	/*) ;;
+	*) SHELL_BIN=$(pwd)/$SHELL_BIN ;;
+esac
+
+DIR=$(mktemp -d /tmp/shell_test_XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+FAILED=0
+
+# applied to the output of the shell before it is compared, test scripts may replace it
+filter()
+{
+	cat
+}
+
+# compare <test> <expected> <actual>
+compare()
+{
+	if [ "$3" = "$2" ]; then
+		echo "$NAME: $1 ok"
+	else
+		printf '%s: %s FAIL\nexpected: %s\nactual: %s\n' "$NAME" "$1" "$2" "$3"
+		FAILED=1
+	fi
+}
+
+# check <test> <expected output>, the script is read from stdin and run in $DIR
+check()
+{
+	cat > "$DIR/script"
+	output=$(cd "$DIR" && timeout 10 "$SHELL_BIN" script 2>&1)
+	if [ $? -eq 124 ]; then
+		echo "$NAME: $1 FAIL, timed out"
+		FAILED=1
+		return
+	fi
+
+	compare "$1" "$2" "$(printf '%s\n' "$output" | filter)"
+}
+
+finish()
+{
+	exit $FAILED
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Pipelines with builtins, functions and process substitutions.
+
+. "$(dirname "$0")/lib.sh"
+
+# the forked function must not hold the read end of its own output
+check function_endless_output y <<'END'
+f() { yes; }
+f | head -1
+END
+
+# same for a builtin which writes more than the pipe holds
+{
+	echo 'set -o pipesize=4096'
+	i=0
+	while [ $i -lt 400 ]; do
+		echo "alias a$i=aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+		i=$((i + 1))
+	done
+	echo 'alias | head -c 5'
+} | check builtin_large_output alias
+
+# the shell of a substitution keeps only its end of the pipe, not the input of the stage
+check substitution_descriptors '0 1 2' <<'END'
+true | cat <(sh -c 'echo $(ls /proc/$PPID/fd)')
+END
+
+finish
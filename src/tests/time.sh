@@ -0,0 +1,28 @@
+#!/bin/sh
+# Usage reports of "time" and "set -o timejobs".
+
+. "$(dirname "$0")/lib.sh"
+
+# only the job text at the end of every report line is compared
+filter()
+{
+	sed 's/^.*csw [0-9]*\/[0-9]*  //'
+}
+
+# reporting is decided when a job starts: "set -o timejobs" is not reported, "set +o timejobs" is
+check timejobs_option '/bin/true
+set +o timejobs' <<'END'
+set -o timejobs
+/bin/true
+set +o timejobs
+/bin/true
+END
+
+check time_keyword 'time /bin/true | /bin/true
+/bin/true
+/bin/true' <<'END'
+time /bin/true | /bin/true
+/bin/true
+END
+
+finish
@@ -0,0 +1,135 @@
+#include "trace.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+struct TraceEvent
+{
+	const char* name;
+	const char* argName;
+	long long time; /* nanoseconds of CLOCK_MONOTONIC */
+	long arg;
+	pid_t pid;
+	char phase;
+};
+
+int g_tracing = 0;
+
+static struct TraceEvent g_events[TRACE_BUFFER_SIZE];
+static unsigned long g_nEvents = 0; /* all events added, the last TRACE_BUFFER_SIZE of them are kept */
+
+void addTraceEvent(char phase, const char* name, pid_t pid, const char* argName, long arg)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	/* a signal handler may add an event in the middle of this one, so the slot is taken atomically */
+	unsigned long index = __atomic_fetch_add(&g_nEvents, 1, __ATOMIC_RELAXED);
+	struct TraceEvent* event = &g_events[index & (TRACE_BUFFER_SIZE - 1)];
+	event->name = name;
+	event->argName = argName;
+	event->time = (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+	event->arg = arg;
+	event->pid = pid;
+	event->phase = phase;
+}
+
+void clearTrace()
+{
+	g_nEvents = 0;
+}
+
+static void addEventJson(struct String* s, const struct TraceEvent* event, pid_t shellPid)
+{
+	char buffer[256];
+	int size = snprintf(buffer, sizeof(buffer), "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d",
+		event->name, event->phase, event->time / 1000, event->time % 1000, shellPid, shellPid);
+	addSymbols(s, buffer, size);
+
+	/* instant events are drawn on the thread track */
+	if (event->phase == TRACE_INSTANT)
+		addSymbols(s, ",\"s\":\"t\"", 8);
+
+	if (event->pid || event->argName)
+	{
+		addSymbols(s, ",\"args\":{", 9);
+		size = 0;
+		if (event->pid)
+			size = snprintf(buffer, sizeof(buffer), "\"pid\":%d%s", event->pid, event->argName ? "," : "");
+
+		if (event->argName)
+			size += snprintf(buffer + size, sizeof(buffer) - (size_t)size, "\"%s\":%ld", event->argName, event->arg);
+
+		addSymbols(s, buffer, size);
+		addSymbol(s, '}');
+	}
+
+	addSymbol(s, '}');
+}
+
+int writeTrace(int fd)
+{
+	unsigned long end = g_nEvents;
+	unsigned long start = end > TRACE_BUFFER_SIZE ? end - TRACE_BUFFER_SIZE : 0;
+	pid_t shellPid = getpid();
+
+	struct String* s = createString();
+	addSymbols(s, "{\"traceEvents\":[\n", 17);
+	for (unsigned long i = start; i < end; ++i)
+	{
+		addEventJson(s, &g_events[i & (TRACE_BUFFER_SIZE - 1)], shellPid);
+		if (i + 1 < end)
+			addSymbol(s, ',');
+
+		addSymbol(s, '\n');
+	}
+
+	addSymbols(s, "],\"displayTimeUnit\":\"ns\"}\n", 26);
+
+	int ret = writeAll(fd, s->data, s->size);
+	freeString(s);
+	return ret;
+}
+
+int trace(int argc, char** argv)
+{
+	if (argc > 1 && !strcmp(argv[1], "-c"))
+	{
+		clearTrace();
+		return 0;
+	}
+
+	int fd = STDOUT_FILENO;
+	if (argc > 1)
+	{
+		fd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if (fd == -1)
+		{
+			fprintf(ERROR_OUTPUT, "trace: %s: %s\n", argv[1], strerror(errno));
+			return 1;
+		}
+	}
+	else
+	{
+		fflush(stdout);
+	}
+
+	int ret = 0;
+	if (writeTrace(fd) == -1)
+	{
+		fprintf(ERROR_OUTPUT, "trace: %s\n", strerror(errno));
+		ret = 1;
+	}
+
+	if (fd != STDOUT_FILENO)
+		close(fd);
+
+	return ret;
+}
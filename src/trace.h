@@ -0,0 +1,37 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <sys/types.h>
+
+/* Timestamped events of the shell kept in a ring buffer of fixed size, so only
+ * the last events are there. Exported in Chrome trace-event format, which can be
+ * opened with chrome://tracing or https://ui.perfetto.dev.
+ * Enabled with "set -o trace" or with $TRACEFILE, which also makes the shell
+ * write the events into that file on exit. */
+
+#define TRACE_BUFFER_SIZE 65536 /* power of two */
+
+#define TRACE_BEGIN 'B'
+#define TRACE_END 'E'
+#define TRACE_INSTANT 'i'
+
+extern int g_tracing;
+
+/* Arguments are not evaluated while tracing is off. */
+#define TRACE(phase, name, pid, argName, arg) \
+	do { if (g_tracing) addTraceEvent(phase, name, pid, argName, (long)(arg)); } while (0)
+
+/* name and argName must be string literals: only pointers are kept.
+ * pid is a process the event is about, 0 if none. Safe in a signal handler. */
+void addTraceEvent(char phase, const char* name, pid_t pid, const char* argName, long arg);
+
+void clearTrace();
+
+/* Returns -1 and sets errno on error. */
+int writeTrace(int fd);
+
+/* trace [-c] [file]
+ * Writes recorded events as JSON to stdout or to file, -c drops them. */
+int trace(int argc, char** argv);
+
+#endif
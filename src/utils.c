@@ -1,11 +1,14 @@
 #include "utils.h"
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 extern struct _IO_FILE* ERROR_OUTPUT;
 
 #define MIN_MEMORY_ALLOCATION_SIZE 1024
+#define READ_BLOCK_SIZE 65536
 #define MAX_MEMORY_GROW_SIZE 65536
 #define MEMORY_GROWTH_FACTOR 1.5
 
@@ -13,6 +16,17 @@ extern struct _IO_FILE* ERROR_OUTPUT;
 #define MAX_GROW_SIZE 64
 #define GROWTH_FACTOR 1.5
 
+#define ARENA_BLOCK_SIZE 16384
+#define ARENA_ALIGNMENT 16
+
+struct ArenaBlock
+{
+	struct ArenaBlock* next;
+	size_t size;
+	size_t used;
+	max_align_t data[];
+};
+
 int min(int a, int b)
 {
 	return a < b ? a : b;
@@ -37,6 +51,137 @@ char* duplicateString(const char* str)
 	return ret;
 }
 
+static struct ArenaBlock* createArenaBlock(size_t size)
+{
+	struct ArenaBlock* block = malloc(sizeof(struct ArenaBlock) + size);
+	if (!block)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+struct Arena* createArena()
+{
+	struct Arena* arena = malloc(sizeof(struct Arena));
+	arena->first = arena->current = createArenaBlock(ARENA_BLOCK_SIZE);
+	return arena;
+}
+
+void emptyArena(struct Arena* arena)
+{
+	/* blocks are kept for the next use */
+	for (struct ArenaBlock* block = arena->first; block; block = block->next)
+		block->used = 0;
+
+	arena->current = arena->first;
+}
+
+void freeArena(struct Arena* arena)
+{
+	if (!arena)
+		return;
+
+	struct ArenaBlock* block = arena->first;
+	while (block)
+	{
+		struct ArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+
+	free(arena);
+}
+
+void* allocateFromArena(struct Arena* arena, size_t size)
+{
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+	struct ArenaBlock* block = arena->current;
+	while (block->used + size > block->size)
+	{
+		if (!block->next)
+			block->next = createArenaBlock(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+		else if (block->next->size < size)
+		{
+			/* kept block is too small, put a bigger one before it */
+			struct ArenaBlock* bigger = createArenaBlock(size);
+			bigger->next = block->next;
+			block->next = bigger;
+		}
+
+		block = block->next;
+	}
+
+	arena->current = block;
+
+	void* ptr = (char*)block->data + block->used;
+	block->used += size;
+	return ptr;
+}
+
+void* reallocateFromArena(struct Arena* arena, void* ptr, size_t oldSize, size_t newSize)
+{
+	struct ArenaBlock* block = arena->current;
+	size_t oldAligned = (oldSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	size_t newAligned = (newSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+	/* the last allocation can grow in place */
+	if (ptr && (char*)ptr + oldAligned == (char*)block->data + block->used && block->used - oldAligned + newAligned <= block->size)
+	{
+		block->used = block->used - oldAligned + newAligned;
+		return ptr;
+	}
+
+	void* newPtr = allocateFromArena(arena, newSize);
+	if (ptr)
+		memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+
+	return newPtr;
+}
+
+char* duplicateArenaString(struct Arena* arena, const char* str)
+{
+	if (!str)
+		return NULL;
+
+	size_t size = strlen(str) + 1;
+	char* ret = allocateFromArena(arena, size);
+	memcpy(ret, str, size);
+	return ret;
+}
+
+struct StringView duplicateArenaView(struct Arena* arena, const char* data, int size)
+{
+	char* copy = allocateFromArena(arena, (size_t)size + 1);
+	memcpy(copy, data, (size_t)size);
+	copy[size] = '\0';
+
+	struct StringView view = { copy, size };
+	return view;
+}
+
+int isViewEqual(struct StringView view, const char* str)
+{
+	return view.data && (int)strlen(str) == view.size && !memcmp(view.data, str, (size_t)view.size);
+}
+
+char* viewToString(struct StringView view)
+{
+	if (!view.data)
+		return NULL;
+
+	char* ret = malloc((size_t)view.size + 1);
+	memcpy(ret, view.data, (size_t)view.size);
+	ret[view.size] = '\0';
+	return ret;
+}
+
 struct String* createString()
 {
 	struct String* ret = malloc(sizeof(struct String));
@@ -50,7 +195,7 @@ struct String* createString()
 
 void emptyString(struct String* s)
 {
-	memset(s->data, 0, (size_t)s->capacity);
+	s->data[0] = '\0';
 	s->size = 0;
 }
 
@@ -75,12 +220,32 @@ void addSymbol(struct String* s, char symbol)
 			exit(1);
 		}
 
-		memset(s->data + s->capacity, 0, (size_t)(newCapacity - s->capacity));
 		s->capacity = newCapacity;
 	}
 
 	s->data[s->size] = symbol;
 	s->size++;
+	s->data[s->size] = '\0';
+}
+
+void addSymbols(struct String* s, const char* symbols, int size)
+{
+	if (s->size + size >= s->capacity)
+	{
+		int newCapacity = max(s->size + size + 1, min((int)(s->capacity * MEMORY_GROWTH_FACTOR), s->capacity + MAX_MEMORY_GROW_SIZE));
+		s->data = realloc(s->data, (size_t)newCapacity);
+		if (!s->data)
+		{
+			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+			exit(1);
+		}
+
+		s->capacity = newCapacity;
+	}
+
+	memcpy(s->data + s->size, symbols, (size_t)size);
+	s->size += size;
+	s->data[s->size] = '\0';
 }
 
 struct StringArray* createStringArray()
@@ -89,6 +254,17 @@ struct StringArray* createStringArray()
 	ret->data = NULL;
 	ret->size = 0;
 	ret->capacity = 0;
+	ret->arena = NULL;
+	return ret;
+}
+
+struct StringArray* createArenaStringArray(struct Arena* arena)
+{
+	struct StringArray* ret = allocateFromArena(arena, sizeof(struct StringArray));
+	ret->data = NULL;
+	ret->size = 0;
+	ret->capacity = 0;
+	ret->arena = arena;
 	return ret;
 }
 
@@ -97,7 +273,7 @@ void emptyStringArray(struct StringArray* sa)
 	if (!sa)
 		return;
 
-	for (int i = 0; i < sa->size; ++i)
+	for (int i = 0; i < sa->size && !sa->arena; ++i)
 		free(sa->data[i]);
 
 	memset(sa->data, 0, (size_t)sa->capacity * sizeof(char*));
@@ -106,7 +282,7 @@ void emptyStringArray(struct StringArray* sa)
 
 void freeStringArray(struct StringArray* sa)
 {
-	if (!sa)
+	if (!sa || sa->arena)
 		return;
 
 	for (int i = 0; i < sa->size; ++i)
@@ -124,7 +300,11 @@ void addString(struct StringArray* sa, const char* str)
 	if (sa->size == sa->capacity)
 	{
 		int newCapacity = min(max((int)(sa->capacity * GROWTH_FACTOR), MIN_SIZE), sa->capacity + MAX_GROW_SIZE);
-		sa->data = realloc(sa->data, (size_t)newCapacity * sizeof(char*));
+		if (sa->arena)
+			sa->data = reallocateFromArena(sa->arena, sa->data, (size_t)sa->capacity * sizeof(char*), (size_t)newCapacity * sizeof(char*));
+		else
+			sa->data = realloc(sa->data, (size_t)newCapacity * sizeof(char*));
+
 		if (!sa->data)
 		{
 			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
@@ -135,7 +315,7 @@ void addString(struct StringArray* sa, const char* str)
 		sa->capacity = newCapacity;
 	}
 
-	sa->data[sa->size] = duplicateString(str);
+	sa->data[sa->size] = sa->arena ? duplicateArenaString(sa->arena, str) : duplicateString(str);
 	sa->size++;
 }
 
@@ -150,7 +330,7 @@ struct IntArray* createIntArray()
 
 void emptyIntArray(struct IntArray* ia)
 {
-	if (!ia)
+	if (!ia || !ia->data)
 		return;
 
 	memset(ia->data, 0, (size_t)ia->capacity * sizeof(int));
@@ -189,9 +369,240 @@ void addInt(struct IntArray* ia, int value)
 	ia->size++;
 }
 
-int getLine(FILE* file, char** buffer, int* size, int* index)
+unsigned int hashString(const char* str)
+{
+	/* FNV-1a */
+	unsigned int hash = 2166136261u;
+	for (; *str; ++str)
+	{
+		hash ^= (unsigned char)*str;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+struct HashTable* createHashTable(void (*freeValue)(void*))
+{
+	struct HashTable* ret = malloc(sizeof(struct HashTable));
+	ret->buckets = NULL;
+	ret->size = 0;
+	ret->capacity = 0;
+	ret->freeValue = freeValue;
+	return ret;
+}
+
+static void freeHashEntry(struct HashTable* ht, struct HashEntry* entry)
+{
+	if (ht->freeValue)
+		ht->freeValue(entry->value);
+
+	free(entry->key);
+	free(entry);
+}
+
+void emptyHashTable(struct HashTable* ht)
+{
+	if (!ht)
+		return;
+
+	for (int i = 0; i < ht->capacity; ++i)
+	{
+		struct HashEntry* entry = ht->buckets[i];
+		while (entry)
+		{
+			struct HashEntry* next = entry->next;
+			freeHashEntry(ht, entry);
+			entry = next;
+		}
+
+		ht->buckets[i] = NULL;
+	}
+
+	ht->size = 0;
+}
+
+void freeHashTable(struct HashTable* ht)
 {
-	if (!buffer || !size || !index || (*buffer && *size <= 0))
+	if (!ht)
+		return;
+
+	emptyHashTable(ht);
+	free(ht->buckets);
+	free(ht);
+}
+
+static struct HashEntry** findHashEntry(const struct HashTable* ht, const char* key, unsigned int hash)
+{
+	if (!ht->capacity)
+		return NULL;
+
+	struct HashEntry** entry = &ht->buckets[hash & (unsigned int)(ht->capacity - 1)];
+	while (*entry && ((*entry)->hash != hash || strcmp((*entry)->key, key)))
+		entry = &(*entry)->next;
+
+	return entry;
+}
+
+void* getHashTableValue(const struct HashTable* ht, const char* key)
+{
+	if (!ht || !key)
+		return NULL;
+
+	struct HashEntry** entry = findHashEntry(ht, key, hashString(key));
+	return entry && *entry ? (*entry)->value : NULL;
+}
+
+static void growHashTable(struct HashTable* ht)
+{
+	/* capacity is always a power of two so bucket index is a mask */
+	int newCapacity = ht->capacity ? ht->capacity * 2 : MIN_SIZE * 2;
+	struct HashEntry** buckets = calloc((size_t)newCapacity, sizeof(struct HashEntry*));
+	if (!buckets)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	for (int i = 0; i < ht->capacity; ++i)
+	{
+		struct HashEntry* entry = ht->buckets[i];
+		while (entry)
+		{
+			struct HashEntry* next = entry->next;
+			struct HashEntry** bucket = &buckets[entry->hash & (unsigned int)(newCapacity - 1)];
+			entry->next = *bucket;
+			*bucket = entry;
+			entry = next;
+		}
+	}
+
+	free(ht->buckets);
+	ht->buckets = buckets;
+	ht->capacity = newCapacity;
+}
+
+void setHashTableValue(struct HashTable* ht, const char* key, void* value)
+{
+	if (!ht || !key)
+		return;
+
+	unsigned int hash = hashString(key);
+	struct HashEntry** entry = findHashEntry(ht, key, hash);
+	if (entry && *entry)
+	{
+		if (ht->freeValue && (*entry)->value != value)
+			ht->freeValue((*entry)->value);
+
+		(*entry)->value = value;
+		return;
+	}
+
+	if (ht->size >= ht->capacity * 3 / 4)
+		growHashTable(ht);
+
+	struct HashEntry* newEntry = malloc(sizeof(struct HashEntry));
+	newEntry->key = duplicateString(key);
+	newEntry->value = value;
+	newEntry->hash = hash;
+
+	struct HashEntry** bucket = &ht->buckets[hash & (unsigned int)(ht->capacity - 1)];
+	newEntry->next = *bucket;
+	*bucket = newEntry;
+	ht->size++;
+}
+
+int removeHashTableValue(struct HashTable* ht, const char* key)
+{
+	if (!ht || !key)
+		return 0;
+
+	struct HashEntry** entry = findHashEntry(ht, key, hashString(key));
+	if (!entry || !*entry)
+		return 0;
+
+	struct HashEntry* removed = *entry;
+	*entry = removed->next;
+	freeHashEntry(ht, removed);
+	ht->size--;
+	return 1;
+}
+
+struct LineReader* createLineReader(int fd)
+{
+	struct LineReader* reader = malloc(sizeof(struct LineReader));
+	reader->fd = fd;
+	reader->capacity = READ_BLOCK_SIZE;
+	reader->data = malloc((size_t)reader->capacity);
+	reader->start = reader->end = 0;
+	reader->eof = reader->error = 0;
+	return reader;
+}
+
+void freeLineReader(struct LineReader* reader)
+{
+	if (!reader)
+		return;
+
+	free(reader->data);
+	free(reader);
+}
+
+int isEndOfInput(const struct LineReader* reader)
+{
+	return reader->eof && reader->start == reader->end;
+}
+
+/* reads next block after the buffered data, returns number of new bytes */
+static int fillLineReader(struct LineReader* reader)
+{
+	if (reader->start > 0)
+	{
+		memmove(reader->data, reader->data + reader->start, (size_t)(reader->end - reader->start));
+		reader->end -= reader->start;
+		reader->start = 0;
+	}
+
+	ssize_t nRead;
+	do
+	{
+		nRead = read(reader->fd, reader->data + reader->end, (size_t)(reader->capacity - reader->end));
+	} while (nRead == -1 && errno == EINTR);
+
+	if (nRead <= 0)
+	{
+		reader->eof = 1;
+		reader->error = nRead == -1;
+		return 0;
+	}
+
+	reader->end += (int)nRead;
+	return (int)nRead;
+}
+
+static void appendToBuffer(char** buffer, int* size, int* index, const char* data, int length)
+{
+	if (*index + length >= *size)
+	{
+		*size = max(*index + length + 1, min(max((int)(*size * MEMORY_GROWTH_FACTOR), MIN_MEMORY_ALLOCATION_SIZE), *size + MAX_MEMORY_GROW_SIZE));
+		char* newBuffer = realloc(*buffer, (size_t)*size);
+		if (!newBuffer)
+		{
+			free(*buffer);
+			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+			exit(1);
+		}
+
+		*buffer = newBuffer;
+	}
+
+	memcpy(*buffer + *index, data, (size_t)length);
+	*index += length;
+}
+
+int getLine(struct LineReader* reader, char** buffer, int* size, int* index)
+{
+	if (!reader || !buffer || !size || !index || (*buffer && *size <= 0))
 		return 1;
 
 	if (!*buffer)
@@ -204,35 +615,52 @@ int getLine(FILE* file, char** buffer, int* size, int* index)
 	if (*index >= *size)
 		return 1;
 
-	int c;
-	int escaped = 0;
-	while ((c = fgetc(file)) != EOF)
+	while (1)
 	{
-		if (*index == *size - 1)
-		{
-			*size = min(max((int)(*size * MEMORY_GROWTH_FACTOR), MIN_MEMORY_ALLOCATION_SIZE), *size + MAX_MEMORY_GROW_SIZE);
-			char* newBuffer = realloc(*buffer, (size_t)*size);
-			if (!newBuffer)
-			{
-				free(*buffer);
-				fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
-				exit(1);
-			}
-
-			*buffer = newBuffer;
-		}
+		if (reader->start == reader->end && !fillLineReader(reader))
+			break;
 
-		if (((*buffer)[(*index)++] = (char)c) == '\n' && !escaped)
-		{
+		const char* begin = reader->data + reader->start;
+		int available = reader->end - reader->start;
+		const char* newLine = memchr(begin, '\n', (size_t)available);
+		int length = newLine ? (int)(newLine - begin) + 1 : available;
 
-			escaped = c == '\\';
-			break;
-		}
+		appendToBuffer(buffer, size, index, begin, length);
+		reader->start += length;
+
+		if (!newLine)
+			continue;
 
-		escaped = c == '\\';
+		/* new line escaped with odd number of slashes continues the line */
+		int nSlashes = 0;
+		for (int i = *index - 2; i >= 0 && (*buffer)[i] == '\\'; --i)
+			++nSlashes;
+
+		if (nSlashes % 2 == 0)
+			break;
 	}
 
 	(*buffer)[*index] = '\0';
 
+	return reader->error;
+}
+
+int writeAll(int fd, const char* data, int size)
+{
+	while (size > 0)
+	{
+		ssize_t written = write(fd, data, (size_t)size);
+		if (written == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return -1;
+		}
+
+		data += written;
+		size -= (int)written;
+	}
+
 	return 0;
-}
\ No newline at end of file
+}
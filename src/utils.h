@@ -1,14 +1,42 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
 #include <stdio.h>
 
 /* MATH */
 int min(int a, int b);
 int max(int a, int b);
 
+/* arena: memory which is released all at once */
+struct ArenaBlock;
+
+struct Arena
+{
+	struct ArenaBlock* first;
+	struct ArenaBlock* current;
+};
+
+struct Arena* createArena();
+void emptyArena(struct Arena* arena);
+void freeArena(struct Arena* arena);
+void* allocateFromArena(struct Arena* arena, size_t size);
+void* reallocateFromArena(struct Arena* arena, void* ptr, size_t oldSize, size_t newSize);
+
 /* string */
 char* duplicateString(const char* str);
+char* duplicateArenaString(struct Arena* arena, const char* str);
+
+/* string view: slice of some other string, not null-terminated */
+struct StringView
+{
+	const char* data;
+	int size;
+};
+
+struct StringView duplicateArenaView(struct Arena* arena, const char* data, int size);
+int isViewEqual(struct StringView view, const char* str);
+char* viewToString(struct StringView view);
 
 struct String
 {
@@ -21,6 +49,7 @@ struct String* createString();
 void emptyString(struct String* s);
 void freeString(struct String* s);
 void addSymbol(struct String* s, char symbol);
+void addSymbols(struct String* s, const char* symbols, int size);
 
 /* string array */
 struct StringArray
@@ -28,9 +57,11 @@ struct StringArray
 	char** data;
 	int size;
 	int capacity;
+	struct Arena* arena; /* if set, array and its strings live in the arena */
 };
 
 struct StringArray* createStringArray();
+struct StringArray* createArenaStringArray(struct Arena* arena);
 void emptyStringArray(struct StringArray* sa);
 void freeStringArray(struct StringArray* sa);
 void addString(struct StringArray* sa, const char* str);
@@ -48,7 +79,54 @@ void emptyIntArray(struct IntArray* ia);
 void freeIntArray(struct IntArray* ia);
 void addInt(struct IntArray* ia, int value);
 
+/* hash table with string keys */
+struct HashEntry
+{
+	char* key;
+	void* value;
+	unsigned int hash;
+	struct HashEntry* next;
+};
+
+struct HashTable
+{
+	struct HashEntry** buckets;
+	int size;
+	int capacity;
+	void (*freeValue)(void*);
+};
+
+unsigned int hashString(const char* str);
+struct HashTable* createHashTable(void (*freeValue)(void*));
+void emptyHashTable(struct HashTable* ht);
+void freeHashTable(struct HashTable* ht);
+void* getHashTableValue(const struct HashTable* ht, const char* key);
+void setHashTableValue(struct HashTable* ht, const char* key, void* value);
+int removeHashTableValue(struct HashTable* ht, const char* key);
+
 /* FILE IO*/
-int getLine(FILE* file, char** buffer, int* size, int* index);
+
+/* Reads input in large blocks and splits it into lines. */
+struct LineReader
+{
+	int fd;
+	char* data;
+	int start;
+	int end;
+	int capacity;
+	int eof;
+	int error;
+};
+
+struct LineReader* createLineReader(int fd);
+void freeLineReader(struct LineReader* reader);
+int isEndOfInput(const struct LineReader* reader);
+
+/* Appends next line (including escaped new lines) to the buffer starting from index.
+ * Returns 1 in case of read error. */
+int getLine(struct LineReader* reader, char** buffer, int* size, int* index);
+
+/* Writes the whole buffer, retrying after short writes and signals. Returns 0 on success. */
+int writeAll(int fd, const char* data, int size);
 
 #endif // UTILS_H
@@ -0,0 +1,348 @@
+#include "utils.h"
+#include "variables.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern struct _IO_FILE* ERROR_OUTPUT;
+
+#define MIN_ARRAY_SIZE 64
+#define MAX_NAME_SIZE 256
+
+struct Variable
+{
+	char* value;
+	int exported;
+	int envIndex; /* position in g_environment, -1 if it is not there */
+};
+
+static struct HashTable* g_variables = NULL;
+
+/* "NAME=value" of exported variables which have a value, NULL-terminated */
+static char** g_environment = NULL;
+static struct Variable** g_environmentVariables = NULL;
+static int g_environmentSize = 0;
+static int g_environmentCapacity = 0;
+
+static void* allocateMemory(size_t size)
+{
+	void* ret = malloc(size);
+	if (!ret)
+	{
+		fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+		exit(1);
+	}
+
+	return ret;
+}
+
+static void freeVariable(void* value)
+{
+	struct Variable* variable = value;
+	free(variable->value);
+	free(variable);
+}
+
+/* returns size of the valid variable name at the start of the text */
+static int getNameSize(const char* text, int size)
+{
+	if (size == 0 || !(isalpha((unsigned char)*text) || *text == '_'))
+		return 0;
+
+	int i = 1;
+	while (i < size && (isalnum((unsigned char)text[i]) || text[i] == '_'))
+		++i;
+
+	return i;
+}
+
+static void setEnvironmentEntry(const char* name, struct Variable* variable)
+{
+	size_t nameSize = strlen(name);
+	size_t valueSize = strlen(variable->value);
+	char* entry = allocateMemory(nameSize + valueSize + 2);
+	memcpy(entry, name, nameSize);
+	entry[nameSize] = '=';
+	memcpy(entry + nameSize + 1, variable->value, valueSize + 1);
+
+	if (variable->envIndex != -1)
+	{
+		free(g_environment[variable->envIndex]);
+		g_environment[variable->envIndex] = entry;
+		return;
+	}
+
+	if (g_environmentSize + 1 >= g_environmentCapacity)
+	{
+		g_environmentCapacity = max(g_environmentCapacity * 2, MIN_ARRAY_SIZE);
+		g_environment = realloc(g_environment, (size_t)g_environmentCapacity * sizeof(char*));
+		g_environmentVariables = realloc(g_environmentVariables, (size_t)g_environmentCapacity * sizeof(struct Variable*));
+		if (!g_environment || !g_environmentVariables)
+		{
+			fprintf(ERROR_OUTPUT, "Application ran out of memory.\n");
+			exit(1);
+		}
+	}
+
+	variable->envIndex = g_environmentSize;
+	g_environment[g_environmentSize] = entry;
+	g_environmentVariables[g_environmentSize] = variable;
+	g_environmentSize++;
+	g_environment[g_environmentSize] = NULL;
+}
+
+static void removeEnvironmentEntry(struct Variable* variable)
+{
+	/* last entry takes place of the removed one */
+	int index = variable->envIndex;
+	int last = g_environmentSize - 1;
+	free(g_environment[index]);
+	g_environment[index] = g_environment[last];
+	g_environmentVariables[index] = g_environmentVariables[last];
+	g_environmentVariables[index]->envIndex = index;
+
+	g_environmentSize--;
+	g_environment[g_environmentSize] = NULL;
+	variable->envIndex = -1;
+}
+
+static struct Variable* getOrCreateVariable(const char* name)
+{
+	struct Variable* variable = getHashTableValue(g_variables, name);
+	if (!variable)
+	{
+		variable = allocateMemory(sizeof(struct Variable));
+		variable->value = NULL;
+		variable->exported = 0;
+		variable->envIndex = -1;
+		setHashTableValue(g_variables, name, variable);
+	}
+
+	return variable;
+}
+
+void initVariables(char** environment)
+{
+	g_variables = createHashTable(freeVariable);
+
+	char name[MAX_NAME_SIZE];
+	for (; environment && *environment; ++environment)
+	{
+		const char* separator = strchr(*environment, '=');
+		int nameSize = separator ? (int)(separator - *environment) : 0;
+		if (!nameSize || nameSize >= MAX_NAME_SIZE)
+			continue;
+
+		memcpy(name, *environment, (size_t)nameSize);
+		name[nameSize] = '\0';
+		exportVariable(name, separator + 1);
+	}
+}
+
+void freeVariables()
+{
+	for (int i = 0; i < g_environmentSize; ++i)
+		free(g_environment[i]);
+
+	free(g_environment);
+	free(g_environmentVariables);
+	g_environment = NULL;
+	g_environmentVariables = NULL;
+	g_environmentSize = g_environmentCapacity = 0;
+
+	freeHashTable(g_variables);
+	g_variables = NULL;
+}
+
+const char* getVariable(const char* name)
+{
+	const struct Variable* variable = getHashTableValue(g_variables, name);
+	return variable ? variable->value : NULL;
+}
+
+const char* findVariable(const char* name, int length)
+{
+	char key[MAX_NAME_SIZE];
+	if (length >= MAX_NAME_SIZE)
+		return NULL;
+
+	memcpy(key, name, (size_t)length);
+	key[length] = '\0';
+	return getVariable(key);
+}
+
+void setVariable(const char* name, const char* value)
+{
+	struct Variable* variable = getOrCreateVariable(name);
+	free(variable->value);
+	variable->value = duplicateString(value);
+
+	if (variable->exported)
+		setEnvironmentEntry(name, variable);
+}
+
+void exportVariable(const char* name, const char* value)
+{
+	struct Variable* variable = getOrCreateVariable(name);
+	variable->exported = 1;
+	if (value)
+	{
+		free(variable->value);
+		variable->value = duplicateString(value);
+	}
+
+	if (variable->value && (value || variable->envIndex == -1))
+		setEnvironmentEntry(name, variable);
+}
+
+int unsetVariable(const char* name)
+{
+	struct Variable* variable = getHashTableValue(g_variables, name);
+	if (!variable)
+		return 0;
+
+	if (variable->envIndex != -1)
+		removeEnvironmentEntry(variable);
+
+	removeHashTableValue(g_variables, name);
+	return 1;
+}
+
+int isVariableName(const char* name)
+{
+	int size = (int)strlen(name);
+	return size > 0 && getNameSize(name, size) == size;
+}
+
+int getAssignmentNameSize(const char* text, int size)
+{
+	int nameSize = getNameSize(text, size);
+	return nameSize && nameSize < size && text[nameSize] == '=' ? nameSize : 0;
+}
+
+void assignVariable(const char* assignment)
+{
+	int nameSize = getAssignmentNameSize(assignment, (int)strlen(assignment));
+	if (!nameSize || nameSize >= MAX_NAME_SIZE)
+		return;
+
+	char name[MAX_NAME_SIZE];
+	memcpy(name, assignment, (size_t)nameSize);
+	name[nameSize] = '\0';
+	setVariable(name, assignment + nameSize + 1);
+}
+
+char* const* getEnvironment()
+{
+	static char* const empty[] = { NULL };
+	return g_environment ? g_environment : empty;
+}
+
+/* compares names of two "NAME=value" strings */
+static int isSameName(const char* left, const char* right)
+{
+	while (*left && *left == *right && *left != '=')
+	{
+		++left;
+		++right;
+	}
+
+	return *left == '=' && *right == '=';
+}
+
+static int isOverridden(const char* entry, char* const* assignments)
+{
+	for (; *assignments; ++assignments)
+	{
+		if (isSameName(entry, *assignments))
+			return 1;
+	}
+
+	return 0;
+}
+
+char** createEnvironment(char* const* assignments)
+{
+	int nAssignments = 0;
+	while (assignments[nAssignments])
+		++nAssignments;
+
+	char** ret = allocateMemory((size_t)(g_environmentSize + nAssignments + 1) * sizeof(char*));
+	int size = 0;
+	for (int i = 0; i < g_environmentSize; ++i)
+	{
+		if (!isOverridden(g_environment[i], assignments))
+			ret[size++] = g_environment[i];
+	}
+
+	/* the last assignment of a name wins */
+	for (int i = 0; i < nAssignments; ++i)
+	{
+		if (!isOverridden(assignments[i], assignments + i + 1))
+			ret[size++] = assignments[i];
+	}
+
+	ret[size] = NULL;
+	return ret;
+}
+
+static int compareNames(const void* left, const void* right)
+{
+	return strcmp(*(char* const*)left, *(char* const*)right);
+}
+
+static void printExported()
+{
+	struct StringArray* names = createStringArray();
+	for (int i = 0; i < g_variables->capacity; ++i)
+	{
+		for (const struct HashEntry* entry = g_variables->buckets[i]; entry; entry = entry->next)
+		{
+			if (((const struct Variable*)entry->value)->exported)
+				addString(names, entry->key);
+		}
+	}
+
+	qsort(names->data, (size_t)names->size, sizeof(char*), compareNames);
+	for (int i = 0; i < names->size; ++i)
+	{
+		const char* value = getVariable(names->data[i]);
+		if (value)
+			printf("export %s=\"%s\"\n", names->data[i], value);
+		else
+			printf("export %s\n", names->data[i]);
+	}
+
+	freeStringArray(names);
+}
+
+int export(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printExported();
+		return 0;
+	}
+
+	int ret = 0;
+	char name[MAX_NAME_SIZE];
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* separator = strchr(argv[i], '=');
+		int nameSize = separator ? (int)(separator - argv[i]) : (int)strlen(argv[i]);
+		if (!nameSize || nameSize >= MAX_NAME_SIZE || getNameSize(argv[i], nameSize) != nameSize)
+		{
+			fprintf(ERROR_OUTPUT, "export: `%s': not a valid identifier\n", argv[i]);
+			ret = 1;
+			continue;
+		}
+
+		memcpy(name, argv[i], (size_t)nameSize);
+		name[nameSize] = '\0';
+		exportVariable(name, separator ? separator + 1 : NULL);
+	}
+
+	return ret;
+}
@@ -0,0 +1,37 @@
+#ifndef VARIABLES_H
+#define VARIABLES_H
+
+/* Shell variables. Exported ones are passed to started programs, their
+ * "NAME=value" array is updated in place when one of them changes. */
+
+/* Imports variables of the environment as exported ones. */
+void initVariables(char** environment);
+void freeVariables();
+
+/* Returns NULL if the variable is not set. */
+const char* getVariable(const char* name);
+const char* findVariable(const char* name, int length);
+
+/* Keeps the variable exported if it was. */
+void setVariable(const char* name, const char* value);
+/* value NULL keeps the current one. */
+void exportVariable(const char* name, const char* value);
+/* Returns 1 if the variable was set. */
+int unsetVariable(const char* name);
+
+/* Returns 1 if the name can be used for a variable. */
+int isVariableName(const char* name);
+/* Returns size of the name if text starts with "NAME=", 0 otherwise. */
+int getAssignmentNameSize(const char* text, int size);
+/* Sets variable from "NAME=value" string. */
+void assignVariable(const char* assignment);
+
+/* Environment for started programs, valid until exported variables change. */
+char* const* getEnvironment();
+/* Environment with "NAME=value" assignments added on top of the exported variables.
+ * Returns new array of pointers, strings are not copied. */
+char** createEnvironment(char* const* assignments);
+
+int export(int argc, char** argv);
+
+#endif